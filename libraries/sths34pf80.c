@@ -9,6 +9,7 @@
  */
 #include "stdint.h"
 #include "sths34pf80.h"
+#include "sths34pf80_conv.h"
 
 /** @defgroup STHS34PF80_Private_Function_Prototypes STHS34PF80 Private Function Prototypes
  * @{
@@ -16,7 +17,94 @@
 
 static int32_t ReadRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
 static int32_t WriteRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+#ifdef PKG_STHS34PF80_USING_STATS
+static int32_t ReadRegStats(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+static int32_t WriteRegStats(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+#endif
 static int32_t STHS34PF80_Initialize(STHS34PF80_Object_t *pObj);
+static uint8_t STHS34PF80_RunODR(uint8_t power, uint8_t odr);
+static int32_t STHS34PF80_SafeODR(STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout);
+
+/**
+ * @brief  One bus transfer under the retry policy: each failed attempt calls
+ *         IO.Recover, waits a doubling backoff and tries again, until the
+ *         retries or the time budget run out. Any failure marks the
+ *         configuration for STHS34PF80_Resync.
+ *
+ *         A read covering FUNC_STATUS is never repeated: the failed attempt
+ *         may have cleared the flags already. A FUNC_CFG_DATA access may
+ *         have moved the embedded address before failing, so FUNC_CFG_ADDR
+ *         is written again before each retry.
+ * @param  pObj the device pObj
+ * @param  read 1 for IO.ReadReg, 0 for IO.WriteReg
+ * @retval 0 in case of success, an error code otherwise
+ */
+static int32_t STHS34PF80_Transfer(STHS34PF80_Object_t *pObj, uint8_t read, uint8_t Reg, uint8_t *pData,
+                                   uint16_t Length)
+{
+  uint32_t start = 0;
+  uint32_t backoff = pObj->Retry.Backoff;
+  uint8_t attempt;
+  uint8_t clear_on_read = read && Reg <= STHS34PF80_FUNC_STATUS && Reg + Length > STHS34PF80_FUNC_STATUS;
+  int32_t ret;
+
+  for (attempt = 0; ; attempt++)
+  {
+    ret = STHS34PF80_OK;
+    if (attempt > 0U && Reg == STHS34PF80_FUNC_CFG_DATA)
+    {
+      ret = pObj->IO.WriteReg(pObj->IO.Handle, pObj->IO.Address, STHS34PF80_FUNC_CFG_ADDR, &pObj->FuncCfgAddr, 1);
+    }
+    if (ret == STHS34PF80_OK)
+    {
+      ret = read ? pObj->IO.ReadReg(pObj->IO.Handle, pObj->IO.Address, Reg, pData, Length)
+                 : pObj->IO.WriteReg(pObj->IO.Handle, pObj->IO.Address, Reg, pData, Length);
+    }
+    if (ret == STHS34PF80_OK)
+    {
+      if (attempt > 0U)
+      {
+        pObj->Faults.Retried++;
+      }
+      if (!read && Reg <= STHS34PF80_FUNC_CFG_ADDR && Reg + Length > STHS34PF80_FUNC_CFG_ADDR)
+      {
+        pObj->FuncCfgAddr = pData[STHS34PF80_FUNC_CFG_ADDR - Reg];
+      }
+      else if (Reg == STHS34PF80_FUNC_CFG_DATA)
+      {
+        /* the embedded address auto-increments with every data access */
+        pObj->FuncCfgAddr = (uint8_t)(pObj->FuncCfgAddr + Length);
+      }
+      return STHS34PF80_OK;
+    }
+
+    /* a glitch that broke a transfer may also have reset the sensor */
+    pObj->Faults.Errors++;
+    pObj->ResyncPending = 1;
+    if (attempt == 0U && pObj->IO.GetTick != NULL)
+    {
+      start = (uint32_t)pObj->IO.GetTick();
+    }
+    if (attempt >= pObj->Retry.Retries || clear_on_read ||
+        (pObj->Retry.Budget != 0U && pObj->IO.GetTick != NULL &&
+         (uint32_t)pObj->IO.GetTick() - start >= pObj->Retry.Budget))
+    {
+      pObj->Faults.Failed++;
+      return STHS34PF80_ERROR;
+    }
+
+    if (pObj->IO.Recover != NULL)
+    {
+      pObj->Faults.Recoveries++;
+      pObj->IO.Recover(pObj->IO.Handle);
+    }
+    if (pObj->IO.Delay != NULL && backoff != 0U)
+    {
+      pObj->IO.Delay(backoff);
+      backoff <<= 1;
+    }
+  }
+}
 
 /**
  * @brief  Wrap Read register component function to Bus IO function
@@ -36,7 +124,7 @@ static int32_t ReadRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t L
   {
     for (i = 0; i < Length; i++)
     {
-      ret = pObj->IO.ReadReg(pObj->IO.Address, (Reg + i), &pData[i], 1);
+      ret = STHS34PF80_Transfer(pObj, 1, (Reg + i), &pData[i], 1);
       if (ret != STHS34PF80_OK)
       {
         return STHS34PF80_ERROR;
@@ -45,9 +133,16 @@ static int32_t ReadRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t L
 
     return ret;
   }
-  else /* SPI 4-Wires or SPI 3-Wires */
+  else /* I2C burst, SPI 4-Wires or SPI 3-Wires */
   {
-    return pObj->IO.ReadReg(pObj->IO.Address, Reg, pData, Length);
+    /* The register address is auto-incremented by the sensor, so the whole
+     * block is moved in a single bus transaction. */
+    if (STHS34PF80_Transfer(pObj, 1, Reg, pData, Length) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+
+    return STHS34PF80_OK;
   }
 }
 
@@ -69,7 +164,7 @@ static int32_t WriteRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t
   {
     for (i = 0; i < Length; i++)
     {
-      ret = pObj->IO.WriteReg(pObj->IO.Address, (Reg + i), &pData[i], 1);
+      ret = STHS34PF80_Transfer(pObj, 0, (Reg + i), &pData[i], 1);
       if (ret != STHS34PF80_OK)
       {
         return STHS34PF80_ERROR;
@@ -78,12 +173,59 @@ static int32_t WriteRegWrap(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t
 
     return ret;
   }
-  else /* SPI 4-Wires or SPI 3-Wires */
+  else /* I2C burst, SPI 4-Wires or SPI 3-Wires */
   {
-    return pObj->IO.WriteReg(pObj->IO.Address, Reg, pData, Length);
+    /* The register address is auto-incremented by the sensor, so the whole
+     * block is moved in a single bus transaction. */
+    if (STHS34PF80_Transfer(pObj, 0, Reg, pData, Length) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+
+    return STHS34PF80_OK;
   }
 }
 
+#ifdef PKG_STHS34PF80_USING_STATS
+/**
+ * @brief  Timed ReadRegWrap, accounted as STHS34PF80_STAT_BUS_READ
+ * @param  Handle the device handler
+ * @param  Reg the register address
+ * @param  pData the stored data pointer
+ * @param  Length the length
+ * @retval 0 in case of success, an error code otherwise
+ */
+static int32_t ReadRegStats(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  STHS34PF80_Object_t *pObj = (STHS34PF80_Object_t *)Handle;
+  uint32_t start = STHS34PF80_STATS_CLOCK(pObj);
+  int32_t ret = ReadRegWrap(Handle, Reg, pData, Length);
+
+  STHS34PF80_StatsRecord(&(pObj->Stats), STHS34PF80_STAT_BUS_READ, ret, STHS34PF80_STATS_CLOCK(pObj) - start);
+
+  return ret;
+}
+
+/**
+ * @brief  Timed WriteRegWrap, accounted as STHS34PF80_STAT_BUS_WRITE
+ * @param  Handle the device handler
+ * @param  Reg the register address
+ * @param  pData the stored data pointer
+ * @param  Length the length
+ * @retval 0 in case of success, an error code otherwise
+ */
+static int32_t WriteRegStats(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  STHS34PF80_Object_t *pObj = (STHS34PF80_Object_t *)Handle;
+  uint32_t start = STHS34PF80_STATS_CLOCK(pObj);
+  int32_t ret = WriteRegWrap(Handle, Reg, pData, Length);
+
+  STHS34PF80_StatsRecord(&(pObj->Stats), STHS34PF80_STAT_BUS_WRITE, ret, STHS34PF80_STATS_CLOCK(pObj) - start);
+
+  return ret;
+}
+#endif
+
 /**
  * @brief  Register Component Bus IO operations
  * @param  pObj the device pObj
@@ -103,13 +245,31 @@ int32_t STHS34PF80_RegisterBusIO(STHS34PF80_Object_t *pObj, STHS34PF80_IO_t *pIO
     pObj->IO.DeInit    = pIO->DeInit;
     pObj->IO.BusType   = pIO->BusType;
     pObj->IO.Address   = pIO->Address;
+    pObj->IO.Handle    = pIO->Handle;
     pObj->IO.WriteReg  = pIO->WriteReg;
     pObj->IO.ReadReg   = pIO->ReadReg;
     pObj->IO.GetTick   = pIO->GetTick;
+    pObj->IO.Delay     = pIO->Delay;
+    pObj->IO.Recover   = pIO->Recover;
 
+#ifdef PKG_STHS34PF80_USING_STATS
+    pObj->Ctx.read_reg  = ReadRegStats;
+    pObj->Ctx.write_reg = WriteRegStats;
+    STHS34PF80_StatsReset(&(pObj->Stats));
+#else
     pObj->Ctx.read_reg  = ReadRegWrap;
     pObj->Ctx.write_reg = WriteRegWrap;
+#endif
     pObj->Ctx.handle   = pObj;
+    pObj->Ctx.shadow   = &(pObj->Shadow);
+    pObj->Events       = 0;
+    pObj->EventsFresh  = 0;
+    pObj->Ctrl3        = 0;
+    pObj->ResyncPending = 0;
+    memset(&(pObj->Faults), 0, sizeof(pObj->Faults));
+    STHS34PF80_SetRetryPolicy(pObj, STHS34PF80_RETRY_COUNT, STHS34PF80_RETRY_BACKOFF, STHS34PF80_RETRY_BUDGET);
+
+    sths34pf80_shadow_invalidate(&(pObj->Ctx));
   }
 
   return ret;
@@ -173,50 +333,306 @@ int32_t STHS34PF80_ReadID(STHS34PF80_Object_t *pObj, uint8_t *Id)
  */
 static int32_t STHS34PF80_Initialize(STHS34PF80_Object_t *pObj)
 {
-    if (sths34pf80_lpf_motion_set(&(pObj->Ctx), pObj->Config.LPF_Motion) != STHS34PF80_OK)
+    sths34pf80_image_t img;
+
+    STHS34PF80_BuildImage(&(pObj->Config), &img);
+    return STHS34PF80_ApplyImage(pObj, &img);
+}
+
+/**
+ * @brief  Encode a configuration as a register image, see STHS34PF80_IMAGE
+ * @param  config the configuration
+ * @param  img the image
+ */
+void STHS34PF80_BuildImage(const STHS34PF80_Config_t *config, sths34pf80_image_t *img)
+{
+    const sths34pf80_image_t built = STHS34PF80_IMAGE(config->LPF_Motion, config->LPF_Presence,
+                                                      config->LPF_Temperature, config->AVG_TMOS, config->ODR,
+                                                      config->THS_Motion, config->THS_Presence,
+                                                      config->THS_Temp_Shock);
+
+    *img = built;
+}
+
+/**
+ * @brief  Take the configuration an image describes as the current one
+ */
+static void STHS34PF80_AdoptImage(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img)
+{
+    sths34pf80_reg_t reg;
+
+    reg.byte = img->lpf1;
+    pObj->Config.LPF_Motion = reg.lpf1.lpf_m;
+    reg.byte = img->lpf2;
+    pObj->Config.LPF_Presence = reg.lpf2.lpf_p;
+    pObj->Config.LPF_Temperature = reg.lpf2.lpf_a_t;
+    reg.byte = img->avg_trim;
+    pObj->Config.AVG_TMOS = reg.avg_trim.avg_tmos;
+    reg.byte = img->ctrl1;
+    pObj->Config.ODR = reg.ctrl_reg1.odr;
+    pObj->Config.THS_Presence = (uint16_t)(img->ths[0] | (img->ths[1] << 8));
+    pObj->Config.THS_Motion = (uint16_t)(img->ths[2] | (img->ths[3] << 8));
+    pObj->Config.THS_Temp_Shock = (uint16_t)(img->ths[4] | (img->ths[5] << 8));
+    pObj->Ctrl3 = img->ctrl3;
+    pObj->is_initialized = 1U;
+}
+
+/**
+ * @brief  The image as the registers should read back: the ODR of img
+ *         limited by the current power mode
+ */
+static void STHS34PF80_RunImage(const STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img,
+                                sths34pf80_image_t *run)
+{
+    sths34pf80_reg_t reg;
+
+    *run = *img;
+    reg.byte = run->ctrl1;
+    reg.ctrl_reg1.odr = STHS34PF80_RunODR(pObj->Power, reg.ctrl_reg1.odr);
+    run->ctrl1 = reg.byte;
+}
+
+/**
+ * @brief  Program a register image with burst writes and no reads, and
+ *         take the configuration it describes as the current one. The ODR
+ *         of the image is limited by the current power mode.
+ * @param  pObj the device pObj
+ * @param  img the image, e.g. a constant built with STHS34PF80_IMAGE
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_ApplyImage(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img)
+{
+    sths34pf80_image_t run;
+
+    /* a suspended sensor takes the configuration but stays suspended */
+    STHS34PF80_RunImage(pObj, img, &run);
+    if (sths34pf80_image_write(&(pObj->Ctx), &run) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_lpf_presence_set(&(pObj->Ctx), pObj->Config.LPF_Presence) != STHS34PF80_OK)
+
+    STHS34PF80_AdoptImage(pObj, img);
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Reprogram the filters, averaging, ODR and thresholds at run time.
+ *         Conversions stop after the one in progress, the INT routing is
+ *         kept, and the sensor resumes in the current power mode.
+ * @param  pObj the device pObj
+ * @param  config the new configuration
+ * @param  timeout wait for the conversion in progress, in GetTick units
+ * @retval 0 in case of success, an error code otherwise, also when the
+ *         averaging in config does not allow its ODR
+ */
+int32_t STHS34PF80_ApplyConfig(STHS34PF80_Object_t *pObj, const STHS34PF80_Config_t *config, uint32_t timeout)
+{
+    sths34pf80_image_t img;
+
+    if (config->ODR == 0 || config->ODR > STHS34PF80_MaxODR(config->AVG_TMOS))
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_lpf_temperature_set(&(pObj->Ctx), pObj->Config.LPF_Temperature) != STHS34PF80_OK)
+    if (STHS34PF80_SafeODR(pObj, 0, timeout) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_avg_trim_avg_tmos_set(&(pObj->Ctx), pObj->Config.AVG_TMOS) != STHS34PF80_OK)
+
+    STHS34PF80_BuildImage(config, &img);
+    img.ctrl3 = pObj->Ctrl3;
+    return STHS34PF80_ApplyImage(pObj, &img);
+}
+
+/**
+ * @brief  Wait for CTRL2.BOOT to clear after a reboot request
+ * @retval 0 in case of success, STHS34PF80_TIMEOUT or an error code otherwise
+ */
+static int32_t STHS34PF80_Reboot(STHS34PF80_Object_t *pObj)
+{
+    uint32_t start = 0, elapsed = 0;
+    uint8_t boot;
+
+    if (sths34pf80_ctrl2_boot_set(&(pObj->Ctx), 1) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_ctrl1_odr_set(&(pObj->Ctx), pObj->Config.ODR) != STHS34PF80_OK)
+    /* every register is back to its reset value */
+    sths34pf80_shadow_invalidate(&(pObj->Ctx));
+
+    if (pObj->IO.GetTick != NULL)
     {
-        return STHS34PF80_ERROR;
+        start = (uint32_t)pObj->IO.GetTick();
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_PRESENCE_THS_L,pObj->Config.THS_Presence & 0xFF) != STHS34PF80_OK)
+    while (1)
     {
-        return STHS34PF80_ERROR;
+        if (sths34pf80_ctrl2_boot_get(&(pObj->Ctx), &boot) != STHS34PF80_OK)
+        {
+            return STHS34PF80_ERROR;
+        }
+        if (!boot)
+        {
+            return STHS34PF80_OK;
+        }
+
+        if (pObj->IO.GetTick != NULL)
+        {
+            elapsed = (uint32_t)pObj->IO.GetTick() - start;
+        }
+        else
+        {
+            elapsed++;
+        }
+        if (elapsed >= STHS34PF80_BOOT_TIMEOUT)
+        {
+            return STHS34PF80_TIMEOUT;
+        }
+        if (pObj->IO.Delay != NULL)
+        {
+            pObj->IO.Delay(1);
+        }
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_PRESENCE_THS_H,(pObj->Config.THS_Presence & 0xFF00)>>8) != STHS34PF80_OK)
+}
+
+/**
+ * @brief  Read the registers back and program only what differs from run
+ * @param  pObj the device pObj
+ * @param  run the registers as they should read back, see STHS34PF80_RunImage
+ * @param  reboot 1 to reboot the sensor with CTRL2.BOOT before reprogramming it
+ * @param  done what had to be done
+ * @retval 0 in case of success, an error code otherwise, also when WHO_AM_I does not match
+ */
+static int32_t STHS34PF80_Restore(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *run, uint8_t reboot,
+                                  STHS34PF80_WarmResult_t *done)
+{
+    sths34pf80_image_t cur;
+    sths34pf80_reg_t reg;
+    uint8_t id;
+
+    if (sths34pf80_image_read(&(pObj->Ctx), &cur, &(reg.byte), &id) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_MOTION_THS_L,pObj->Config.THS_Motion & 0xFF) != STHS34PF80_OK)
+    if (id != STHS34PF80_ID)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_MOTION_THS_H,(pObj->Config.THS_Motion & 0xFF00)>>8) != STHS34PF80_OK)
+
+    if (!reg.ctrl_reg2.func_cfg_access &&
+        cur.lpf1 == run->lpf1 && cur.lpf2 == run->lpf2 && cur.avg_trim == run->avg_trim &&
+        cur.ctrl1 == run->ctrl1 && memcmp(cur.ths, run->ths, sizeof(cur.ths)) == 0)
+    {
+        /* CTRL3 can change while converting */
+        *done = STHS34PF80_WARM_VERIFIED;
+        if (cur.ctrl3 != run->ctrl3)
+        {
+            if (sths34pf80_ctrl3_set(&(pObj->Ctx), run->ctrl3) != STHS34PF80_OK)
+            {
+                return STHS34PF80_ERROR;
+            }
+            *done = STHS34PF80_WARM_CTRL3;
+        }
+        return STHS34PF80_OK;
+    }
+
+    /* a reset during an embedded session leaves the page open */
+    if (reg.ctrl_reg2.func_cfg_access || reboot)
+    {
+        if (STHS34PF80_Reboot(pObj) != STHS34PF80_OK)
+        {
+            return STHS34PF80_ERROR;
+        }
+        *done = STHS34PF80_WARM_REBOOTED;
+    }
+    else
+    {
+        *done = STHS34PF80_WARM_REPROGRAMMED;
+    }
+    if (sths34pf80_image_write(&(pObj->Ctx), run) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_TAMBSHOCK_THS_L,pObj->Config.THS_Temp_Shock & 0xFF) != STHS34PF80_OK)
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Take over a sensor that kept its power across an MCU reset: read the
+ *         configuration back and program only what differs from img, so a
+ *         sensor that is already configured keeps converting undisturbed
+ * @param  pObj the device pObj
+ * @param  img the wanted configuration
+ * @param  reboot 1 to reboot the sensor with CTRL2.BOOT before reprogramming it
+ * @param  result what had to be done, may be NULL
+ * @retval 0 in case of success, an error code otherwise, also when WHO_AM_I does not match
+ */
+int32_t STHS34PF80_WarmStart(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img, uint8_t reboot,
+                             STHS34PF80_WarmResult_t *result)
+{
+    sths34pf80_image_t run;
+    STHS34PF80_WarmResult_t done;
+
+    STHS34PF80_RunImage(pObj, img, &run);
+    if (STHS34PF80_Restore(pObj, &run, reboot, &done) != STHS34PF80_OK)
     {
         return STHS34PF80_ERROR;
     }
-    if (sths34pf80_threshold_set(&(pObj->Ctx),STHS34PF80_TAMBSHOCK_THS_H,(pObj->Config.THS_Temp_Shock & 0xFF00)>>8) != STHS34PF80_OK)
+
+    STHS34PF80_AdoptImage(pObj, img);
+    if (result != NULL)
+    {
+        *result = done;
+    }
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Set the retry policy of the bus wrappers, see STHS34PF80_Retry_t
+ * @param  pObj the device pObj
+ * @param  retries attempts after the first one, 0 to fail at once
+ * @param  backoff wait before the first retry, doubled for each next one, in GetTick units
+ * @param  budget give up once a transfer has been failing this long, 0 for no bound
+ */
+void STHS34PF80_SetRetryPolicy(STHS34PF80_Object_t *pObj, uint8_t retries, uint32_t backoff, uint32_t budget)
+{
+    pObj->Retry.Retries = retries;
+    pObj->Retry.Backoff = backoff;
+    pObj->Retry.Budget = budget;
+}
+
+/**
+ * @brief  Bring the registers back to the current configuration after a bus
+ *         fault, e.g. when ResyncPending is set. Whatever still matches is
+ *         left alone, a sensor that lost its configuration is reprogrammed.
+ * @param  pObj the device pObj
+ * @param  result what had to be done, may be NULL
+ * @retval 0 in case of success, an error code otherwise. ResyncPending stays
+ *         set after a failed run, and is set again by a transfer that only
+ *         went through on a retry, so the next run checks once more.
+ */
+int32_t STHS34PF80_Resync(STHS34PF80_Object_t *pObj, STHS34PF80_WarmResult_t *result)
+{
+    sths34pf80_image_t img, run;
+    STHS34PF80_WarmResult_t done;
+
+    STHS34PF80_BuildImage(&(pObj->Config), &img);
+    img.ctrl3 = pObj->Ctrl3;
+    STHS34PF80_RunImage(pObj, &img, &run);
+
+    /* set again by any transfer that fails on the way */
+    pObj->ResyncPending = 0;
+    if (STHS34PF80_Restore(pObj, &run, 0, &done) != STHS34PF80_OK)
     {
+        pObj->ResyncPending = 1;
         return STHS34PF80_ERROR;
     }
+
+    if (done != STHS34PF80_WARM_VERIFIED)
+    {
+        pObj->Faults.Resyncs++;
+    }
+    if (result != NULL)
+    {
+        *result = done;
+    }
     return STHS34PF80_OK;
 }
 
@@ -228,7 +644,7 @@ static int32_t STHS34PF80_Initialize(STHS34PF80_Object_t *pObj)
  */
 int32_t STHS34PF80_ReadPresence(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_presence = 0;
+  uint16_t data_raw_presence = 0;
 
   if (sths34pf80_tpresence_get(&(pObj->Ctx), &data_raw_presence) != STHS34PF80_OK)
   {
@@ -248,14 +664,14 @@ int32_t STHS34PF80_ReadPresence(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ReadPresenceFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_flag = 0;
+  uint8_t events = 0;
 
-  if (sths34pf80_pres_flag_get(&(pObj->Ctx), &data_raw_flag) != STHS34PF80_OK)
+  if (STHS34PF80_ReadEvents(pObj, STHS34PF80_EVENT_PRESENCE, &events) != STHS34PF80_OK)
   {
     return STHS34PF80_ERROR;
   }
 
-  *value = data_raw_flag;
+  *value = (events != 0U);
 
   return STHS34PF80_OK;
 }
@@ -268,7 +684,7 @@ int32_t STHS34PF80_ReadPresenceFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ReadTemperature(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_temp = 0;
+  uint16_t data_raw_temp = 0;
 
   if (sths34pf80_tambient_get(&(pObj->Ctx), &data_raw_temp) != STHS34PF80_OK)
   {
@@ -280,6 +696,28 @@ int32_t STHS34PF80_ReadTemperature(STHS34PF80_Object_t *pObj, uint16_t *value)
   return STHS34PF80_OK;
 }
 
+/**
+ * @brief  Get the object temperature compensated for the ambient temperature
+ * @param  pObj the device pObj
+ * @param  value pointer where the object temperature in 0.01 degC is written
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_ReadObjectTemperature(STHS34PF80_Object_t *pObj, int32_t *value)
+{
+  uint8_t buf[4];
+
+  /* TOBJECT and TAMBIENT are adjacent, one burst keeps them from the same cycle */
+  if (sths34pf80_object_ambient_get(&(pObj->Ctx), buf) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  *value = STHS34PF80_CompensateObject((int16_t)(buf[1] << 8 | buf[0]), (int16_t)(buf[3] << 8 | buf[2]),
+                                       STHS34PF80_UNIT_CCELSIUS);
+
+  return STHS34PF80_OK;
+}
+
 /**
  * @brief  Get the STHS34PF80 Temp_Shock flag
  * @param  pObj the device pObj
@@ -288,14 +726,14 @@ int32_t STHS34PF80_ReadTemperature(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ReadTempShockFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_flag = 0;
+  uint8_t events = 0;
 
-  if (sths34pf80_tamb_shock_flag_get(&(pObj->Ctx), &data_raw_flag) != STHS34PF80_OK)
+  if (STHS34PF80_ReadEvents(pObj, STHS34PF80_EVENT_TAMB_SHOCK, &events) != STHS34PF80_OK)
   {
     return STHS34PF80_ERROR;
   }
 
-  *value = data_raw_flag;
+  *value = (events != 0U);
 
   return STHS34PF80_OK;
 }
@@ -310,7 +748,7 @@ int32_t STHS34PF80_ReadTempShockFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ReadMotion(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_motion = 0;
+  uint16_t data_raw_motion = 0;
 
   if (sths34pf80_tmotion_get(&(pObj->Ctx), &data_raw_motion) != STHS34PF80_OK)
   {
@@ -330,15 +768,248 @@ int32_t STHS34PF80_ReadMotion(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ReadMotionFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
 {
-  uint32_t data_raw_flag = 0;
+  uint8_t events = 0;
+
+  if (STHS34PF80_ReadEvents(pObj, STHS34PF80_EVENT_MOTION, &events) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  *value = (events != 0U);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Latch a FUNC_STATUS value, the register clears on read so nothing may be dropped
+ * @param  pObj the device pObj
+ * @param  status FUNC_STATUS value just read from the sensor
+ */
+void STHS34PF80_LatchEvents(STHS34PF80_Object_t *pObj, uint8_t status)
+{
+  pObj->Events |= status & STHS34PF80_EVENT_ALL;
+  pObj->EventsFresh = STHS34PF80_EVENT_ALL;
+}
+
+/**
+ * @brief  Read FUNC_STATUS once and merge its flags into the event latch
+ * @param  pObj the device pObj
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_PollEvents(STHS34PF80_Object_t *pObj)
+{
+  uint8_t status;
+
+  if (sths34pf80_read_reg(&(pObj->Ctx), STHS34PF80_FUNC_STATUS, &status, 1) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  STHS34PF80_LatchEvents(pObj, status);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Get and acknowledge latched events. FUNC_STATUS is only read again once a
+ *         requested flag has already been delivered since the previous read, so
+ *         consumers checking different flags share one bus read per cycle.
+ * @param  pObj the device pObj
+ * @param  mask STHS34PF80_EVENT_* bits of interest
+ * @param  events pointer where the latched bits of mask are written
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_ReadEvents(STHS34PF80_Object_t *pObj, uint8_t mask, uint8_t *events)
+{
+  if ((pObj->EventsFresh & mask) != mask)
+  {
+    if (STHS34PF80_PollEvents(pObj) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+  }
+
+  *events = pObj->Events & mask;
+  pObj->Events &= (uint8_t)~mask;
+  pObj->EventsFresh &= (uint8_t)~mask;
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Get every output of one ODR cycle with a single burst read
+ * @param  pObj the device pObj
+ * @param  frame pointer where the decoded STATUS..TAMB_SHOCK block is written
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_ReadFrame(STHS34PF80_Object_t *pObj, STHS34PF80_Frame_t *frame)
+{
+  uint8_t buf[STHS34PF80_OUTPUT_BLOCK_LEN];
+
+  if (sths34pf80_output_block_get(&(pObj->Ctx), buf) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  STHS34PF80_DecodeFrame(pObj, buf, frame);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Decode a raw STATUS..TAMB_SHOCK_H block and latch its FUNC_STATUS flags
+ * @param  pObj the device pObj
+ * @param  buf STHS34PF80_OUTPUT_BLOCK_LEN bytes read from STHS34PF80_STATUS
+ * @param  frame the decoded output block
+ */
+void STHS34PF80_DecodeFrame(STHS34PF80_Object_t *pObj, const uint8_t *buf, STHS34PF80_Frame_t *frame)
+{
+  sths34pf80_reg_t reg;
+
+#define STHS34PF80_BLOCK_WORD(reg_l) \
+  ((int16_t)(buf[(reg_l) - STHS34PF80_STATUS + 1] << 8 | buf[(reg_l) - STHS34PF80_STATUS]))
+
+  reg.byte = buf[STHS34PF80_STATUS - STHS34PF80_STATUS];
+  frame->Drdy = reg.status.drdy;
+  frame->FuncStatus = buf[STHS34PF80_FUNC_STATUS - STHS34PF80_STATUS] & STHS34PF80_EVENT_ALL;
+  STHS34PF80_LatchEvents(pObj, frame->FuncStatus);
+  frame->TObject = STHS34PF80_BLOCK_WORD(STHS34PF80_TOBJECT_L);
+  frame->TAmbient = STHS34PF80_BLOCK_WORD(STHS34PF80_TAMBIENT_L);
+  frame->TPresence = STHS34PF80_BLOCK_WORD(STHS34PF80_TPRESENCE_L);
+  frame->TMotion = STHS34PF80_BLOCK_WORD(STHS34PF80_TMOTION_L);
+  frame->TAmbShock = STHS34PF80_BLOCK_WORD(STHS34PF80_TAMB_SHOCK_L);
+
+#undef STHS34PF80_BLOCK_WORD
+
+  if (pObj->FrameHook != NULL)
+  {
+    pObj->FrameHook(pObj->FrameHookArg, frame);
+  }
+}
+
+/**
+ * @brief  Install a function that sees every frame read from the sensor
+ * @param  pObj the device pObj
+ * @param  hook the function, NULL to remove it
+ * @param  arg passed to hook
+ */
+void STHS34PF80_SetFrameHook(STHS34PF80_Object_t *pObj, STHS34PF80_FrameHook_Func hook, void *arg)
+{
+  pObj->FrameHook = NULL;
+  pObj->FrameHookArg = arg;
+  pObj->FrameHook = hook;
+}
+
+/**
+ * @brief  Start a single conversion, the sensor must be in power-down (ODR = 0)
+ * @param  pObj the device pObj
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_TriggerOneShot(STHS34PF80_Object_t *pObj)
+{
+  uint8_t odr;
+
+  if (sths34pf80_ctrl1_odr_get(&(pObj->Ctx), &odr) != STHS34PF80_OK || odr != 0)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  /* reading FUNC_STATUS clears DRDY, keep whatever it reports */
+  if (STHS34PF80_PollEvents(pObj) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  return sths34pf80_ctrl2_one_shot_set(&(pObj->Ctx), 1);
+}
+
+/**
+ * @brief  Poll STATUS.DRDY with exponential backoff
+ * @param  pObj the device pObj
+ * @param  timeout in GetTick units, counted in polls when there is no GetTick
+ * @retval 0 when data is ready, STHS34PF80_TIMEOUT or an error code otherwise
+ */
+int32_t STHS34PF80_WaitDataReady(STHS34PF80_Object_t *pObj, uint32_t timeout)
+{
+  uint32_t start = 0, elapsed = 0, backoff = 1;
+  uint8_t drdy;
+
+  if (pObj->IO.GetTick != NULL)
+  {
+    start = (uint32_t)pObj->IO.GetTick();
+  }
+
+  while (1)
+  {
+    if (sths34pf80_drdy_get(&(pObj->Ctx), &drdy) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+    if (drdy)
+    {
+      return STHS34PF80_OK;
+    }
+
+    if (pObj->IO.GetTick != NULL)
+    {
+      elapsed = (uint32_t)pObj->IO.GetTick() - start;
+    }
+    else
+    {
+      elapsed++;
+    }
+    if (elapsed >= timeout)
+    {
+      return STHS34PF80_TIMEOUT;
+    }
+
+    if (pObj->IO.Delay != NULL)
+    {
+      pObj->IO.Delay(backoff);
+      if (backoff < STHS34PF80_ONESHOT_BACKOFF_MAX)
+      {
+        backoff <<= 1;
+      }
+    }
+  }
+}
+
+/**
+ * @brief  Acquire one frame on demand, the sensor stays in power-down otherwise
+ * @param  pObj the device pObj
+ * @param  frame the decoded output block
+ * @param  timeout DRDY wait bound, see STHS34PF80_WaitDataReady
+ * @retval 0 in case of success, STHS34PF80_TIMEOUT or an error code otherwise
+ */
+int32_t STHS34PF80_ReadFrameOneShot(STHS34PF80_Object_t *pObj, STHS34PF80_Frame_t *frame, uint32_t timeout)
+{
+  int32_t ret;
 
-  if (sths34pf80_mot_flag_get(&(pObj->Ctx), &data_raw_flag) != STHS34PF80_OK)
+  if (STHS34PF80_TriggerOneShot(pObj) != STHS34PF80_OK)
   {
     return STHS34PF80_ERROR;
   }
 
-  *value = data_raw_flag;
+  ret = STHS34PF80_WaitDataReady(pObj, timeout);
+  if (ret != STHS34PF80_OK)
+  {
+    return ret;
+  }
+
+  return STHS34PF80_ReadFrame(pObj, frame);
+}
 
+/**
+ * @brief  Write CTRL3 and keep it as the routing STHS34PF80_Resync restores
+ */
+static int32_t STHS34PF80_WriteCtrl3(STHS34PF80_Object_t *pObj, uint8_t ctrl3)
+{
+  if (sths34pf80_ctrl3_set(&(pObj->Ctx), ctrl3) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  pObj->Ctrl3 = ctrl3;
   return STHS34PF80_OK;
 }
 
@@ -350,20 +1021,273 @@ int32_t STHS34PF80_ReadMotionFlag(STHS34PF80_Object_t *pObj, uint16_t *value)
  */
 int32_t STHS34PF80_ControlINT(STHS34PF80_Object_t *pObj, uint8_t msk_id, uint8_t state)
 {
-    sths34pf80_ctrl3_ien_set(&(pObj->Ctx), 0x02);
+    sths34pf80_reg_t reg;
+
+    reg.byte = pObj->Ctrl3;
+    reg.ctrl_reg3.ien = 0x02;
     switch(msk_id)
     {
     case 0:
-        sths34pf80_ctrl3_int_msk0_set(&(pObj->Ctx), state);
+        reg.ctrl_reg3.int_msk0 = state;
         break;
     case 1:
-        sths34pf80_ctrl3_int_msk1_set(&(pObj->Ctx), state);
+        reg.ctrl_reg3.int_msk1 = state;
         break;
     case 2:
-        sths34pf80_ctrl3_int_msk2_set(&(pObj->Ctx), state);
+        reg.ctrl_reg3.int_msk2 = state;
         break;
     default:
         break;
     }
+    return STHS34PF80_WriteCtrl3(pObj, reg.byte);
+}
+
+/**
+ * @brief  Select the INT pin source, CTRL3.IEN
+ * @param  pObj the device pObj
+ * @param  ien 0 for high impedance, 1 for DRDY, 2 for the flags in INT_MSK
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_RouteINT(STHS34PF80_Object_t *pObj, uint8_t ien)
+{
+  sths34pf80_reg_t reg;
+
+  reg.byte = pObj->Ctrl3;
+  reg.ctrl_reg3.ien = ien;
+  return STHS34PF80_WriteCtrl3(pObj, reg.byte);
+}
+
+/**
+ * @brief  Fastest ODR allowed with an averaging setting
+ * @param  avg_tmos AVG_TRIM.AVG_TMOS
+ * @retval the ODR code
+ */
+uint8_t STHS34PF80_MaxODR(uint8_t avg_tmos)
+{
+  /* AVG_TMOS 2..32 allow 30 Hz, every further doubling halves the rate */
+  static const uint8_t max_odr[8] = { 0x08, 0x08, 0x08, 0x06, 0x05, 0x04, 0x03, 0x02 };
+
+  return max_odr[avg_tmos & 0x07];
+}
+
+/**
+ * @brief  Conversion period of an ODR code
+ * @retval the period in ms, rounded up, 0 for power-down
+ */
+uint32_t STHS34PF80_ODRPeriodMs(uint8_t odr)
+{
+  static const uint16_t period_ms[9] = { 0, 4000, 2000, 1000, 500, 250, 125, 67, 34 };
+
+  odr &= 0x0F;
+  return period_ms[odr < 9 ? odr : 8];
+}
+
+/**
+ * @brief  ODR the sensor converts at in a power mode
+ */
+static uint8_t STHS34PF80_RunODR(uint8_t power, uint8_t odr)
+{
+  switch (power)
+  {
+  case STHS34PF80_POWER_LOW:
+    return odr < STHS34PF80_ODR_LOW_POWER ? odr : STHS34PF80_ODR_LOW_POWER;
+  case STHS34PF80_POWER_DOWN:
+    return 0;
+  default:
+    return odr;
+  }
+}
+
+/**
+ * @brief  Move to another ODR the way the datasheet requires: a running sensor
+ *         finishes the conversion in progress before it is powered down, and
+ *         the algorithm is reset in power-down before any new ODR starts
+ * @param  pObj the device pObj
+ * @param  odr the new ODR code, 0 for power-down
+ * @param  timeout wait for the conversion in progress, in GetTick units; 0
+ *         right after a frame was read, when a conversion has just ended
+ * @retval 0 in case of success, an error code otherwise
+ */
+static int32_t STHS34PF80_SafeODR(STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout)
+{
+  uint8_t current;
+  uint8_t reset = 1;
+
+  if (sths34pf80_ctrl1_odr_get(&(pObj->Ctx), &current) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+  if (current == odr)
+  {
+    return STHS34PF80_OK;
+  }
+
+  if (current != 0)
+  {
+    /* clear DRDY, keeping the flags, then wait for the next one; a conversion
+     * that never completes is cut short rather than blocking the caller */
+    if (timeout != 0U &&
+        (STHS34PF80_PollEvents(pObj) != STHS34PF80_OK ||
+         STHS34PF80_WaitDataReady(pObj, timeout) == STHS34PF80_ERROR))
+    {
+      return STHS34PF80_ERROR;
+    }
+    if (sths34pf80_ctrl1_odr_set(&(pObj->Ctx), 0) != STHS34PF80_OK ||
+        STHS34PF80_PollEvents(pObj) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+  }
+
+  if (odr != 0)
+  {
+    if (sths34pf80_func_cfg_write(&(pObj->Ctx), STHS34PF80_RESET_ALGO, &reset, 1) != STHS34PF80_OK ||
+        sths34pf80_ctrl1_odr_set(&(pObj->Ctx), odr) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+  }
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Change the configured ODR. The sensor only runs at it in
+ *         STHS34PF80_POWER_NORMAL, other modes keep it for later.
+ * @param  pObj the device pObj
+ * @param  odr the ODR code, 1 (0.25 Hz) to 8 (30 Hz)
+ * @param  timeout wait for the conversion in progress, in GetTick units, 0
+ *         to switch at once right after a frame was read
+ * @retval 0 in case of success, an error code otherwise, also when the
+ *         averaging in Config.AVG_TMOS does not allow odr
+ */
+int32_t STHS34PF80_SetODR(STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout)
+{
+  if (odr == 0 || odr > STHS34PF80_MaxODR(pObj->Config.AVG_TMOS))
+  {
+    return STHS34PF80_ERROR;
+  }
+  if (STHS34PF80_SafeODR(pObj, STHS34PF80_RunODR(pObj->Power, odr), timeout) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  pObj->Config.ODR = odr;
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Suspend or resume conversions. The registers keep the configuration
+ *         in power-down, so resuming is an algorithm reset and a CTRL1 write.
+ * @param  pObj the device pObj
+ * @param  mode the power mode
+ * @param  timeout wait for the conversion in progress, in GetTick units
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_SetPowerMode(STHS34PF80_Object_t *pObj, STHS34PF80_Power_t mode, uint32_t timeout)
+{
+  if (STHS34PF80_SafeODR(pObj, STHS34PF80_RunODR(mode, pObj->Config.ODR), timeout) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  pObj->Power = mode;
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Drop the cached control registers, e.g. after the sensor lost power
+ * @param  pObj the device pObj
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_InvalidateCache(STHS34PF80_Object_t *pObj)
+{
+    sths34pf80_shadow_invalidate(&(pObj->Ctx));
+
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Reload the cached control registers from the sensor
+ * @param  pObj the device pObj
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_SyncCache(STHS34PF80_Object_t *pObj)
+{
+    if (sths34pf80_shadow_sync(&(pObj->Ctx)) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Write the presence, motion and ambient shock thresholds in one
+ *         embedded page session. A running sensor finishes the conversion
+ *         in progress and is powered down for the session, the algorithm is
+ *         reset and the previous ODR resumes afterwards.
+ * @param  pObj the device pObj
+ * @param  presence, motion, tamb_shock 15-bit thresholds
+ * @param  timeout wait for the conversion in progress, in GetTick units
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_SetThresholds(STHS34PF80_Object_t *pObj, uint16_t presence, uint16_t motion, uint16_t tamb_shock,
+                                 uint32_t timeout)
+{
+    uint8_t buf[6];
+    uint8_t odr;
+    int32_t ret;
+
+    /* PRESENCE_THS_L/H, MOTION_THS_L/H, TAMBSHOCK_THS_L/H are contiguous */
+    buf[0] = presence & 0xFF;
+    buf[1] = (presence >> 8) & 0x7F;
+    buf[2] = motion & 0xFF;
+    buf[3] = (motion >> 8) & 0x7F;
+    buf[4] = tamb_shock & 0xFF;
+    buf[5] = (tamb_shock >> 8) & 0x7F;
+
+    /* embedded registers may only be written in power-down */
+    if (sths34pf80_ctrl1_odr_get(&(pObj->Ctx), &odr) != STHS34PF80_OK ||
+        STHS34PF80_SafeODR(pObj, 0, timeout) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    ret = sths34pf80_func_cfg_write(&(pObj->Ctx), STHS34PF80_PRESENCE_THS_L, buf, sizeof(buf));
+    /* restart even if the session failed, from a reset algorithm */
+    if (odr != 0 && STHS34PF80_SafeODR(pObj, odr, 0) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    if (ret != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+
+    pObj->Config.THS_Presence = presence & 0x7FFF;
+    pObj->Config.THS_Motion = motion & 0x7FFF;
+    pObj->Config.THS_Temp_Shock = tamb_shock & 0x7FFF;
+
+    return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Read back the presence, motion and ambient shock thresholds in one embedded page session
+ * @param  pObj the device pObj
+ * @param  presence, motion, tamb_shock pointers where the thresholds are written
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_GetThresholds(STHS34PF80_Object_t *pObj, uint16_t *presence, uint16_t *motion, uint16_t *tamb_shock)
+{
+    uint8_t buf[6];
+
+    if (sths34pf80_func_cfg_read(&(pObj->Ctx), STHS34PF80_PRESENCE_THS_L, buf, sizeof(buf)) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+
+    *presence = buf[1] << 8 | buf[0];
+    *motion = buf[3] << 8 | buf[2];
+    *tamb_shock = buf[5] << 8 | buf[4];
+
     return STHS34PF80_OK;
 }
@@ -12,12 +12,17 @@
 
 #include "sths34pf80_reg.h"
 #include <string.h>
+#ifdef PKG_STHS34PF80_USING_STATS
+#include "sths34pf80_stats.h"
+#endif
 
 typedef int32_t (*STHS34PF80_Init_Func)(void);
 typedef int32_t (*STHS34PF80_DeInit_Func)(void);
 typedef int32_t (*STHS34PF80_GetTick_Func)(void);
-typedef int32_t (*STHS34PF80_WriteReg_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
-typedef int32_t (*STHS34PF80_ReadReg_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
+typedef void    (*STHS34PF80_Delay_Func)(uint32_t);
+typedef int32_t (*STHS34PF80_WriteReg_Func)(void *, uint16_t, uint16_t, uint8_t *, uint16_t);
+typedef int32_t (*STHS34PF80_ReadReg_Func)(void *, uint16_t, uint16_t, uint8_t *, uint16_t);
+typedef int32_t (*STHS34PF80_Recover_Func)(void *);
 
 typedef struct
 {
@@ -25,11 +30,31 @@ typedef struct
     STHS34PF80_DeInit_Func        DeInit;
     uint32_t                      BusType;
     uint8_t                       Address;
+    void                         *Handle;     /* bus handle passed back to ReadReg/WriteReg */
     STHS34PF80_WriteReg_Func      WriteReg;
     STHS34PF80_ReadReg_Func       ReadReg;
     STHS34PF80_GetTick_Func       GetTick;
+    STHS34PF80_Delay_Func         Delay;      /* optional, sleeps for GetTick units */
+    STHS34PF80_Recover_Func       Recover;    /* optional, frees a stuck bus before a retry, gets Handle */
 } STHS34PF80_IO_t;
 
+/* How the bus wrappers retry a failed transfer */
+typedef struct
+{
+    uint8_t     Retries;        /* attempts after the first one */
+    uint32_t    Backoff;        /* wait before the first retry, doubled for each next one, GetTick units */
+    uint32_t    Budget;         /* give up once a transfer has been failing this long, 0 for no bound */
+} STHS34PF80_Retry_t;
+
+typedef struct
+{
+    uint32_t    Errors;         /* failed attempts */
+    uint32_t    Retried;        /* transfers that went through on a retry */
+    uint32_t    Failed;         /* transfers given up */
+    uint32_t    Recoveries;     /* IO.Recover calls */
+    uint32_t    Resyncs;        /* STHS34PF80_Resync runs that had to write */
+} STHS34PF80_Faults_t;
+
 typedef struct
 {
     uint8_t     LPF_Motion;
@@ -42,12 +67,57 @@ typedef struct
     uint16_t    THS_Temp_Shock;
 } STHS34PF80_Config_t;
 
+typedef struct
+{
+    uint8_t     Drdy;
+    uint8_t     FuncStatus;
+    int16_t     TObject;
+    int16_t     TAmbient;
+    int16_t     TPresence;
+    int16_t     TMotion;
+    int16_t     TAmbShock;
+} STHS34PF80_Frame_t;
+
+/* Conversion state, the configuration is kept in every mode */
+typedef enum
+{
+    STHS34PF80_POWER_NORMAL = 0,        /* converting at Config.ODR */
+    STHS34PF80_POWER_LOW,               /* at most STHS34PF80_ODR_LOW_POWER */
+    STHS34PF80_POWER_DOWN,              /* no conversions */
+} STHS34PF80_Power_t;
+
+/* What STHS34PF80_WarmStart had to do */
+typedef enum
+{
+    STHS34PF80_WARM_VERIFIED = 0,       /* configuration intact, nothing written */
+    STHS34PF80_WARM_CTRL3,              /* only CTRL3 rewritten, conversions kept running */
+    STHS34PF80_WARM_REPROGRAMMED,       /* image written */
+    STHS34PF80_WARM_REBOOTED,           /* CTRL2.BOOT, then image written */
+} STHS34PF80_WarmResult_t;
+
+/* Called with every frame read from the sensor, in the reader's context */
+typedef void (*STHS34PF80_FrameHook_Func)(void *arg, const STHS34PF80_Frame_t *frame);
+
 typedef struct
 {
     STHS34PF80_IO_t        IO;
     sths34pf80_ctx_t       Ctx;
     STHS34PF80_Config_t    Config;
+    sths34pf80_shadow_t    Shadow;
+    uint8_t             Events;         /* latched FUNC_STATUS flags not yet acknowledged */
+    uint8_t             EventsFresh;    /* flags not yet delivered since the last FUNC_STATUS read */
     uint8_t             is_initialized;
+    uint8_t             Power;          /* STHS34PF80_Power_t */
+    uint8_t             Ctrl3;          /* INT routing as last set, restored by STHS34PF80_Resync */
+    uint8_t             ResyncPending;  /* a transfer failed, the registers may no longer match */
+    uint8_t             FuncCfgAddr;    /* embedded address the next FUNC_CFG_DATA access uses */
+    STHS34PF80_Retry_t  Retry;
+    STHS34PF80_Faults_t Faults;
+    STHS34PF80_FrameHook_Func FrameHook;    /* optional, e.g. a trace recorder */
+    void               *FrameHookArg;
+#ifdef PKG_STHS34PF80_USING_STATS
+    STHS34PF80_Stats_t  Stats;
+#endif
 } STHS34PF80_Object_t;
 
 /**
@@ -60,7 +130,117 @@ typedef struct
 
 #define STHS34PF80_OK                0
 #define STHS34PF80_ERROR            -1
+#define STHS34PF80_TIMEOUT          -2
+
+#define STHS34PF80_ID                0xD3U  /* WHO_AM_I */
+#define STHS34PF80_BOOT_TIMEOUT      10U    /* CTRL2.BOOT completion, GetTick units */
+#define STHS34PF80_ODR_LOW_POWER     0x03U  /* 1 Hz */
+
+#define STHS34PF80_ONESHOT_BACKOFF_MAX  8U  /* longest DRDY poll interval, GetTick units */
 
-#define STHS34PF80_I2C_BUS          0U
+/* Retry policy set by STHS34PF80_RegisterBusIO, see STHS34PF80_Retry_t */
+#ifndef STHS34PF80_RETRY_COUNT
+#define STHS34PF80_RETRY_COUNT       2U
+#endif
+#ifndef STHS34PF80_RETRY_BACKOFF
+#define STHS34PF80_RETRY_BACKOFF     1U
+#endif
+#ifndef STHS34PF80_RETRY_BUDGET
+#define STHS34PF80_RETRY_BUDGET      20U
+#endif
+
+#define STHS34PF80_EVENT_TAMB_SHOCK  0x01U  /* FUNC_STATUS.TAMB_SHOCK_FLAG */
+#define STHS34PF80_EVENT_MOTION      0x02U  /* FUNC_STATUS.MOT_FLAG */
+#define STHS34PF80_EVENT_PRESENCE    0x04U  /* FUNC_STATUS.PRES_FLAG */
+#define STHS34PF80_EVENT_ALL         0x07U
+
+#define STHS34PF80_I2C_BUS          0U  /* one transaction per register */
+#define STHS34PF80_I2C_BURST_BUS    1U  /* multi-byte transfers using register auto-increment */
+
+/* sths34pf80_image_t initializer for a configuration, arguments in the order
+ * of STHS34PF80_Config_t. Fields outside the config keep their reset value,
+ * BDU is set and CTRL3 routes nothing to INT. */
+#define STHS34PF80_IMAGE(lpf_m, lpf_p, lpf_t, avg_tmos, odr, ths_m, ths_p, ths_s)     \
+  {                                                                                     \
+    (uint8_t)((lpf_m) & 0x07U),                                                         \
+    (uint8_t)((((lpf_p) & 0x07U) << 3) | ((lpf_t) & 0x07U)),                            \
+    (uint8_t)((avg_tmos) & 0x07U),                                                      \
+    (uint8_t)(0x10U | ((odr) & 0x0FU)),                                                 \
+    0x00U,                                                                              \
+    {                                                                                   \
+      (uint8_t)((ths_p) & 0xFFU), (uint8_t)(((ths_p) >> 8) & 0x7FU),                    \
+      (uint8_t)((ths_m) & 0xFFU), (uint8_t)(((ths_m) >> 8) & 0x7FU),                    \
+      (uint8_t)((ths_s) & 0xFFU), (uint8_t)(((ths_s) >> 8) & 0x7FU)                     \
+    }                                                                                   \
+  }
+
+#ifdef PKG_STHS34PF80_USING_STATS
+/* Latency clock, GetTick by default. Override with a cycle counter
+ * (e.g. DWT->CYCCNT) to resolve sub-tick bus transfers. */
+#ifndef STHS34PF80_STATS_CLOCK
+#define STHS34PF80_STATS_CLOCK(pObj)    ((pObj)->IO.GetTick != NULL ? (uint32_t)(pObj)->IO.GetTick() : 0U)
+#endif
+/* ret = call, timed and accounted under id */
+#define STHS34PF80_STATS_CALL(pObj, id, ret, call)                                      \
+  do                                                                                    \
+  {                                                                                     \
+    uint32_t stats_start_ = STHS34PF80_STATS_CLOCK(pObj);                               \
+    (ret) = (call);                                                                     \
+    STHS34PF80_StatsRecord(&((pObj)->Stats), (id), (ret), STHS34PF80_STATS_CLOCK(pObj) - stats_start_); \
+  } while (0)
+#else
+#define STHS34PF80_STATS_CALL(pObj, id, ret, call)   ((ret) = (call))
+#endif
+
+/**
+ * @}
+ */
+
+/** @defgroup STHS34PF80_Exported_Functions STHS34PF80 Exported Functions
+ * @{
+ */
+
+int32_t STHS34PF80_RegisterBusIO(STHS34PF80_Object_t *pObj, STHS34PF80_IO_t *pIO);
+int32_t STHS34PF80_Init(STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_DeInit(STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_ReadID(STHS34PF80_Object_t *pObj, uint8_t *Id);
+int32_t STHS34PF80_ReadPresence(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_ReadPresenceFlag(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_ReadTemperature(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_ReadObjectTemperature(STHS34PF80_Object_t *pObj, int32_t *value);
+int32_t STHS34PF80_ReadTempShockFlag(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_ReadMotion(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_ReadMotionFlag(STHS34PF80_Object_t *pObj, uint16_t *value);
+int32_t STHS34PF80_PollEvents(STHS34PF80_Object_t *pObj);
+void STHS34PF80_LatchEvents(STHS34PF80_Object_t *pObj, uint8_t status);
+int32_t STHS34PF80_ReadEvents(STHS34PF80_Object_t *pObj, uint8_t mask, uint8_t *events);
+int32_t STHS34PF80_ReadFrame(STHS34PF80_Object_t *pObj, STHS34PF80_Frame_t *frame);
+void STHS34PF80_DecodeFrame(STHS34PF80_Object_t *pObj, const uint8_t *buf, STHS34PF80_Frame_t *frame);
+void STHS34PF80_SetFrameHook(STHS34PF80_Object_t *pObj, STHS34PF80_FrameHook_Func hook, void *arg);
+int32_t STHS34PF80_TriggerOneShot(STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_WaitDataReady(STHS34PF80_Object_t *pObj, uint32_t timeout);
+int32_t STHS34PF80_ReadFrameOneShot(STHS34PF80_Object_t *pObj, STHS34PF80_Frame_t *frame, uint32_t timeout);
+int32_t STHS34PF80_ControlINT(STHS34PF80_Object_t *pObj, uint8_t msk_id, uint8_t state);
+int32_t STHS34PF80_RouteINT(STHS34PF80_Object_t *pObj, uint8_t ien);
+uint8_t STHS34PF80_MaxODR(uint8_t avg_tmos);
+uint32_t STHS34PF80_ODRPeriodMs(uint8_t odr);
+int32_t STHS34PF80_SetODR(STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout);
+int32_t STHS34PF80_SetPowerMode(STHS34PF80_Object_t *pObj, STHS34PF80_Power_t mode, uint32_t timeout);
+int32_t STHS34PF80_InvalidateCache(STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_SyncCache(STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_SetThresholds(STHS34PF80_Object_t *pObj, uint16_t presence, uint16_t motion, uint16_t tamb_shock,
+                                 uint32_t timeout);
+int32_t STHS34PF80_GetThresholds(STHS34PF80_Object_t *pObj, uint16_t *presence, uint16_t *motion, uint16_t *tamb_shock);
+void STHS34PF80_BuildImage(const STHS34PF80_Config_t *config, sths34pf80_image_t *img);
+int32_t STHS34PF80_ApplyImage(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img);
+int32_t STHS34PF80_ApplyConfig(STHS34PF80_Object_t *pObj, const STHS34PF80_Config_t *config, uint32_t timeout);
+int32_t STHS34PF80_WarmStart(STHS34PF80_Object_t *pObj, const sths34pf80_image_t *img, uint8_t reboot,
+                             STHS34PF80_WarmResult_t *result);
+void STHS34PF80_SetRetryPolicy(STHS34PF80_Object_t *pObj, uint8_t retries, uint32_t backoff, uint32_t budget);
+int32_t STHS34PF80_Resync(STHS34PF80_Object_t *pObj, STHS34PF80_WarmResult_t *result);
+
+/**
+ * @}
+ */
 
 #endif /* APPLICATIONS_STHS34PF80_H_ */
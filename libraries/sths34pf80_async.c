@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_async.h"
+
+#define STHS34PF80_ASYNC_FRAME      1U
+#define STHS34PF80_ASYNC_THRESHOLDS 2U
+
+static void STHS34PF80_AsyncRun(STHS34PF80_AsyncJob_t *job);
+
+/**
+ * @brief  Append one transfer to the job program
+ * @retval buffer position reserved for its data
+ */
+static uint8_t *STHS34PF80_AsyncOp(STHS34PF80_AsyncJob_t *job, uint8_t read, uint8_t reg, uint8_t len)
+{
+  STHS34PF80_AsyncOp_t *op = &job->Ops[job->Count++];
+  uint8_t offset = (job->Count > 1) ? (uint8_t)(job->Ops[job->Count - 2].Offset + job->Ops[job->Count - 2].Len) : 0;
+
+  op->Read = read;
+  op->Reg = reg;
+  op->Offset = offset;
+  op->Len = len;
+  op->Until = 0;
+
+  return &job->Buf[offset];
+}
+
+static int32_t STHS34PF80_AsyncStart(STHS34PF80_AsyncJob_t *job, STHS34PF80_AsyncDone_Func done, void *arg)
+{
+  job->Pc = 0;
+  job->Byte = 0;
+  job->Waiting = 0;
+  job->Ret = STHS34PF80_OK;
+  job->Done = done;
+  job->Arg = arg;
+  job->Elapsed = 0;
+  job->Start = (job->pObj->IO.GetTick != NULL) ? (uint32_t)job->pObj->IO.GetTick() : 0U;
+
+  STHS34PF80_AsyncRun(job);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Apply the result of a finished program to the object and report it
+ */
+static void STHS34PF80_AsyncFinish(STHS34PF80_AsyncJob_t *job)
+{
+  STHS34PF80_Object_t *pObj = job->pObj;
+
+  if (job->Ret == STHS34PF80_OK)
+  {
+    if (job->Kind == STHS34PF80_ASYNC_FRAME)
+    {
+      STHS34PF80_DecodeFrame(pObj, &job->Buf[job->Ops[0].Offset], job->Frame);
+    }
+    else
+    {
+      pObj->Config.THS_Presence = job->Ths[0];
+      pObj->Config.THS_Motion = job->Ths[1];
+      pObj->Config.THS_Temp_Shock = job->Ths[2];
+    }
+  }
+  else
+  {
+    /* reported like a transfer given up by the blocking API, so the glue
+     * resyncs the configuration on its next pass */
+    pObj->Faults.Failed++;
+    pObj->ResyncPending = 1;
+    if (job->Kind == STHS34PF80_ASYNC_THRESHOLDS)
+    {
+      /* the control registers may be anywhere in the sequence */
+      sths34pf80_shadow_invalidate(&(pObj->Ctx));
+    }
+  }
+
+  job->Busy = 0;
+  if (job->Done != NULL)
+  {
+    job->Done(job, job->Ret, job->Arg);
+  }
+}
+
+/**
+ * @brief  Move the program on after the current transfer ended with ret
+ */
+static void STHS34PF80_AsyncAdvance(STHS34PF80_AsyncJob_t *job, int32_t ret)
+{
+  const STHS34PF80_AsyncOp_t *op = &job->Ops[job->Pc];
+  STHS34PF80_Object_t *pObj = job->pObj;
+
+  if (ret != STHS34PF80_OK)
+  {
+    pObj->Faults.Errors++;
+    if (job->Ret == STHS34PF80_OK)
+    {
+      job->Ret = STHS34PF80_ERROR;
+    }
+    job->Byte = 0;
+    /* skip to the cleanup ops, or past the failed one if already there */
+    job->Pc = (job->Pc < job->Cleanup) ? job->Cleanup : (uint8_t)(job->Pc + 1);
+    return;
+  }
+
+  if (pObj->IO.BusType == STHS34PF80_I2C_BUS && ++job->Byte < op->Len)
+  {
+    return;
+  }
+  job->Byte = 0;
+
+  if (op->Read && op->Reg == STHS34PF80_FUNC_STATUS)
+  {
+    /* the read that cleared DRDY also cleared the flags */
+    STHS34PF80_LatchEvents(pObj, job->Buf[op->Offset]);
+  }
+  if (op->Until != 0U && (job->Buf[op->Offset] & op->Until) == 0U)
+  {
+    if (pObj->IO.GetTick != NULL)
+    {
+      job->Elapsed = (uint32_t)pObj->IO.GetTick() - job->Start;
+    }
+    else
+    {
+      job->Elapsed++;
+    }
+    /* as STHS34PF80_WaitDataReady, but a conversion that never completes
+     * is cut short rather than failing the program; until then the op is
+     * read again only from STHS34PF80_AsyncResume, not in a loop */
+    if (job->Elapsed < job->Timeout)
+    {
+      job->Waiting = 1;
+      return;
+    }
+  }
+  job->Pc++;
+}
+
+/**
+ * @brief  Issue transfers until one is left in flight or the program ends
+ */
+static void STHS34PF80_AsyncRun(STHS34PF80_AsyncJob_t *job)
+{
+  const STHS34PF80_AsyncOp_t *op;
+  int32_t ret;
+
+  while (job->Pc < job->Count)
+  {
+    if (job->Waiting)
+    {
+      return;
+    }
+    op = &job->Ops[job->Pc];
+    if (job->pObj->IO.BusType == STHS34PF80_I2C_BUS)
+    {
+      ret = job->Submit(job->Handle, job->pObj->IO.Address, (uint8_t)(op->Reg + job->Byte),
+                        &job->Buf[op->Offset + job->Byte], 1, op->Read, job);
+    }
+    else
+    {
+      ret = job->Submit(job->Handle, job->pObj->IO.Address, op->Reg,
+                        &job->Buf[op->Offset], op->Len, op->Read, job);
+    }
+
+    if (ret == STHS34PF80_OK)
+    {
+      /* in flight, STHS34PF80_AsyncComplete resumes; the job is not ours any more */
+      return;
+    }
+    STHS34PF80_AsyncAdvance(job, (ret == STHS34PF80_ASYNC_DONE) ? STHS34PF80_OK : ret);
+  }
+
+  STHS34PF80_AsyncFinish(job);
+}
+
+/**
+ * @brief  Bind a job to a sensor object and a non-blocking bus
+ * @param  job the job, one program at a time
+ * @param  pObj the device pObj, registered and initialized
+ * @param  submit starts one transfer
+ * @param  handle passed back to submit
+ */
+void STHS34PF80_AsyncInit(STHS34PF80_AsyncJob_t *job, STHS34PF80_Object_t *pObj,
+                          STHS34PF80_AsyncSubmit_Func submit, void *handle)
+{
+  memset(job, 0, sizeof(*job));
+  job->pObj = pObj;
+  job->Submit = submit;
+  job->Handle = handle;
+}
+
+/**
+ * @brief  Report the end of the transfer in flight, callable from an ISR
+ * @param  job the job given to Submit
+ * @param  ret 0 if the transfer succeeded
+ */
+void STHS34PF80_AsyncComplete(STHS34PF80_AsyncJob_t *job, int32_t ret)
+{
+  STHS34PF80_AsyncAdvance(job, ret);
+  STHS34PF80_AsyncRun(job);
+}
+
+/**
+ * @brief  Go on with a job parked waiting for the sensor: the register it
+ *         waits on is read once more, and the program continues when the
+ *         bit is set or the timeout has passed
+ *
+ * Call it from the DRDY interrupt, and from a timer (about one conversion
+ * period) when the interrupt is not wired or as a backstop for the timeout;
+ * a call while the job is not parked does nothing. Without GetTick the
+ * timeout counts calls.
+ * @param  job the job
+ * @retval 0 if the job was parked and has been resumed, an error code otherwise
+ */
+int32_t STHS34PF80_AsyncResume(STHS34PF80_AsyncJob_t *job)
+{
+  if (!job->Busy || !job->Waiting)
+  {
+    return STHS34PF80_ERROR;
+  }
+  job->Waiting = 0;
+  STHS34PF80_AsyncRun(job);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Read the whole output block without blocking, as STHS34PF80_ReadFrame
+ * @param  job an idle job
+ * @param  frame filled before done is called
+ * @param  done completion callback, may run in the Submit completion context
+ * @param  arg passed to done
+ * @retval 0 if the program started, an error code otherwise
+ */
+int32_t STHS34PF80_AsyncReadFrame(STHS34PF80_AsyncJob_t *job, STHS34PF80_Frame_t *frame,
+                                  STHS34PF80_AsyncDone_Func done, void *arg)
+{
+  if (job->Busy)
+  {
+    return STHS34PF80_ERROR;
+  }
+  job->Busy = 1;
+
+  job->Count = 0;
+  job->Kind = STHS34PF80_ASYNC_FRAME;
+  job->Frame = frame;
+  STHS34PF80_AsyncOp(job, 1, STHS34PF80_STATUS, STHS34PF80_OUTPUT_BLOCK_LEN);
+  job->Cleanup = job->Count;
+
+  return STHS34PF80_AsyncStart(job, done, arg);
+}
+
+/**
+ * @brief  Program the three thresholds without blocking, as STHS34PF80_SetThresholds
+ *
+ * The embedded page is only writable in power-down: a running sensor is
+ * stopped at the end of a conversion, as STHS34PF80_SetODR does, and
+ * restarted after an algorithm reset in the same page session. While the
+ * conversion runs the job is parked, not polling: the caller resumes it with
+ * STHS34PF80_AsyncResume() from the DRDY interrupt or a timer. The page is
+ * always closed and CTRL1/CTRL2 restored, even after a failed transfer; a
+ * failure sets ResyncPending like the blocking API. The program is built
+ * from the register cache, so no bus access happens here once the object is
+ * initialized.
+ * @param  job an idle job
+ * @param  presence PRESENCE_THS, 15 bits
+ * @param  motion MOTION_THS, 15 bits
+ * @param  tamb_shock TAMBSHOCK_THS, 15 bits
+ * @param  timeout wait for the conversion in progress, in GetTick units, 0
+ *         to stop at once right after a frame was read
+ * @param  done completion callback, may run in the Submit completion context
+ * @param  arg passed to done
+ * @retval 0 if the program started, an error code otherwise
+ */
+int32_t STHS34PF80_AsyncSetThresholds(STHS34PF80_AsyncJob_t *job, uint16_t presence, uint16_t motion,
+                                      uint16_t tamb_shock, uint32_t timeout,
+                                      STHS34PF80_AsyncDone_Func done, void *arg)
+{
+  sths34pf80_ctx_t *ctx = &(job->pObj->Ctx);
+  sths34pf80_reg_t reg, status;
+  uint8_t ctrl1, ctrl2, odr;
+  uint8_t *data;
+  uint16_t ths[3];
+  uint8_t i;
+
+  if (job->Busy)
+  {
+    return STHS34PF80_ERROR;
+  }
+  if (sths34pf80_shadow_get(ctx, STHS34PF80_CTRL1, &ctrl1) != STHS34PF80_OK ||
+      sths34pf80_shadow_get(ctx, STHS34PF80_CTRL2, &ctrl2) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+  job->Busy = 1;
+
+  ths[0] = presence & 0x7FFF;
+  ths[1] = motion & 0x7FFF;
+  ths[2] = tamb_shock & 0x7FFF;
+  reg.byte = ctrl1;
+  odr = reg.ctrl_reg1.odr;
+
+  job->Count = 0;
+  job->Kind = STHS34PF80_ASYNC_THRESHOLDS;
+  job->Timeout = timeout;
+  memcpy(job->Ths, ths, sizeof(ths));
+
+  if (odr != 0)
+  {
+    if (timeout != 0U)
+    {
+      /* clear DRDY, then wait for the conversion in progress */
+      STHS34PF80_AsyncOp(job, 1, STHS34PF80_FUNC_STATUS, 1);
+      STHS34PF80_AsyncOp(job, 1, STHS34PF80_STATUS, 1);
+      status.byte = 0;
+      status.status.drdy = 1;
+      job->Ops[job->Count - 1].Until = status.byte;
+    }
+    /* stop conversions, then clear what the last one raised */
+    reg.ctrl_reg1.odr = 0;
+    *STHS34PF80_AsyncOp(job, 0, STHS34PF80_CTRL1, 1) = reg.byte;
+    STHS34PF80_AsyncOp(job, 1, STHS34PF80_FUNC_STATUS, 1);
+  }
+  reg.byte = ctrl2;
+  reg.ctrl_reg2.func_cfg_access = 1;
+  *STHS34PF80_AsyncOp(job, 0, STHS34PF80_CTRL2, 1) = reg.byte;
+  *STHS34PF80_AsyncOp(job, 0, STHS34PF80_PAGE_RW, 1) = STHS34PF80_FUNC_CFG_WRITE;
+  *STHS34PF80_AsyncOp(job, 0, STHS34PF80_FUNC_CFG_ADDR, 1) = STHS34PF80_PRESENCE_THS_L;
+  for (i = 0; i < 3; i++)
+  {
+    /* FUNC_CFG_DATA is written once per embedded register, the page address auto-increments */
+    data = STHS34PF80_AsyncOp(job, 0, STHS34PF80_FUNC_CFG_DATA, 1);
+    data[0] = ths[i] & 0xFF;
+    data = STHS34PF80_AsyncOp(job, 0, STHS34PF80_FUNC_CFG_DATA, 1);
+    data[0] = (ths[i] >> 8) & 0x7F;
+  }
+  if (odr != 0)
+  {
+    /* restart the algorithm from the new thresholds */
+    *STHS34PF80_AsyncOp(job, 0, STHS34PF80_FUNC_CFG_ADDR, 1) = STHS34PF80_RESET_ALGO;
+    *STHS34PF80_AsyncOp(job, 0, STHS34PF80_FUNC_CFG_DATA, 1) = 1;
+  }
+
+  job->Cleanup = job->Count;
+  *STHS34PF80_AsyncOp(job, 0, STHS34PF80_PAGE_RW, 1) = 0;
+  *STHS34PF80_AsyncOp(job, 0, STHS34PF80_CTRL2, 1) = ctrl2;
+  if (odr != 0)
+  {
+    *STHS34PF80_AsyncOp(job, 0, STHS34PF80_CTRL1, 1) = ctrl1;
+  }
+
+  return STHS34PF80_AsyncStart(job, done, arg);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_ASYNC_H_
+#define STHS34PF80_ASYNC_H_
+
+#include "sths34pf80.h"
+
+/* Non-blocking register sequences. A job is a short program of bus
+ * transfers; each one is handed to the Submit hook and the next starts when
+ * the transfer completes, so a DMA or interrupt-driven controller can run
+ * the whole sequence without a thread waiting on it. A program that has to
+ * wait for the sensor parks instead of polling, and goes on when the
+ * application calls STHS34PF80_AsyncResume() (DRDY interrupt or timer). */
+
+#define STHS34PF80_ASYNC_MAX_OPS    20U
+#define STHS34PF80_ASYNC_BUF_LEN    32U
+
+/* Submit return code: the transfer already finished, no completion will follow */
+#define STHS34PF80_ASYNC_DONE       1
+
+typedef struct STHS34PF80_AsyncJob STHS34PF80_AsyncJob_t;
+
+/* Start one transfer. Return STHS34PF80_OK and call STHS34PF80_AsyncComplete()
+ * later (ISR, DMA callback or thread), STHS34PF80_ASYNC_DONE when the transfer
+ * was done in place, or an error code. */
+typedef int32_t (*STHS34PF80_AsyncSubmit_Func)(void *handle, uint16_t addr, uint8_t reg,
+                                               uint8_t *data, uint16_t len, uint8_t read,
+                                               STHS34PF80_AsyncJob_t *job);
+typedef void (*STHS34PF80_AsyncDone_Func)(STHS34PF80_AsyncJob_t *job, int32_t ret, void *arg);
+
+typedef struct
+{
+    uint8_t     Read;
+    uint8_t     Reg;
+    uint8_t     Offset;     /* data position in the job buffer */
+    uint8_t     Len;
+    uint8_t     Until;      /* park until one of these bits is set, 0 for once */
+} STHS34PF80_AsyncOp_t;
+
+struct STHS34PF80_AsyncJob
+{
+    STHS34PF80_Object_t         *pObj;
+    STHS34PF80_AsyncSubmit_Func  Submit;
+    void                        *Handle;
+
+    STHS34PF80_AsyncOp_t         Ops[STHS34PF80_ASYNC_MAX_OPS];
+    uint8_t                      Buf[STHS34PF80_ASYNC_BUF_LEN];
+    uint8_t                      Count;
+    uint8_t                      Pc;
+    uint8_t                      Byte;       /* position inside an op on single-byte buses */
+    uint8_t                      Cleanup;    /* first op still run after an error */
+    uint8_t                      Kind;
+    volatile uint8_t             Busy;
+    volatile uint8_t             Waiting;    /* parked on an Until op, see STHS34PF80_AsyncResume */
+    int32_t                      Ret;
+    uint32_t                     Start;      /* GetTick at the start, for Timeout */
+    uint32_t                     Elapsed;
+    uint32_t                     Timeout;
+
+    STHS34PF80_Frame_t          *Frame;
+    uint16_t                     Ths[3];
+    STHS34PF80_AsyncDone_Func    Done;
+    void                        *Arg;
+};
+
+void STHS34PF80_AsyncInit(STHS34PF80_AsyncJob_t *job, STHS34PF80_Object_t *pObj,
+                          STHS34PF80_AsyncSubmit_Func submit, void *handle);
+int32_t STHS34PF80_AsyncReadFrame(STHS34PF80_AsyncJob_t *job, STHS34PF80_Frame_t *frame,
+                                  STHS34PF80_AsyncDone_Func done, void *arg);
+int32_t STHS34PF80_AsyncSetThresholds(STHS34PF80_AsyncJob_t *job, uint16_t presence, uint16_t motion,
+                                      uint16_t tamb_shock, uint32_t timeout,
+                                      STHS34PF80_AsyncDone_Func done, void *arg);
+void STHS34PF80_AsyncComplete(STHS34PF80_AsyncJob_t *job, int32_t ret);
+int32_t STHS34PF80_AsyncResume(STHS34PF80_AsyncJob_t *job);
+
+#endif /* STHS34PF80_ASYNC_H_ */
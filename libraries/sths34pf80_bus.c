@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_bus.h"
+
+/**
+ * @brief  Empty the queue and clear its statistics
+ * @param  q the queue
+ */
+void STHS34PF80_BusInit(STHS34PF80_BusQueue_t *q)
+{
+  memset(q, 0, sizeof(STHS34PF80_BusQueue_t));
+}
+
+/**
+ * @brief  Describe one register transfer and pick its class: reads from
+ *         STATUS upwards serve the frame path, anything else is configuration
+ * @param  req the request, owned by the caller until it completes
+ * @param  arg handed back to the port with the request
+ */
+void STHS34PF80_BusReqInit(STHS34PF80_BusReq_t *req, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                           uint8_t read, void *arg)
+{
+  req->Next = NULL;
+  req->Addr = addr;
+  req->Reg = reg;
+  req->Read = read;
+  req->Data = data;
+  req->Len = len;
+  req->Prio = (read && reg >= STHS34PF80_STATUS) ? STHS34PF80_BUS_PRIO_DATA : STHS34PF80_BUS_PRIO_CONFIG;
+  req->Result = STHS34PF80_ERROR;
+  req->Arg = arg;
+}
+
+/**
+ * @brief  Queue a request behind the others of its class
+ * @param  q the queue
+ * @param  req the request
+ */
+void STHS34PF80_BusPush(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t *req)
+{
+  req->Next = NULL;
+  if (q->Tail[req->Prio] == NULL)
+  {
+    q->Head[req->Prio] = req;
+  }
+  else
+  {
+    q->Tail[req->Prio]->Next = req;
+  }
+  q->Tail[req->Prio] = req;
+
+  q->Stats.Requests[req->Prio]++;
+  q->Stats.Depth++;
+  if (q->Stats.Depth > q->Stats.PeakDepth)
+  {
+    q->Stats.PeakDepth = q->Stats.Depth;
+  }
+}
+
+/**
+ * @brief  Take the next batch: data requests first, configuration fills the
+ *         slots left. Configuration left waiting goes first once it has been
+ *         passed over STHS34PF80_BUS_CONFIG_AGE times, so a steady stream of
+ *         output reads cannot starve it.
+ * @param  q the queue
+ * @param  batch receives the requests, in the order to issue them
+ * @param  max size of batch
+ * @retval number of requests taken, 0 if the queue is empty
+ */
+uint32_t STHS34PF80_BusTake(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t **batch, uint32_t max)
+{
+  STHS34PF80_BusReq_t *req;
+  uint32_t n = 0;
+  uint32_t i, prio;
+
+  for (i = 0; i < STHS34PF80_BUS_PRIO_NUM; i++)
+  {
+    prio = (q->Age >= STHS34PF80_BUS_CONFIG_AGE) ? STHS34PF80_BUS_PRIO_NUM - 1U - i : i;
+    while (n < max && q->Head[prio] != NULL)
+    {
+      req = q->Head[prio];
+      q->Head[prio] = req->Next;
+      req->Next = NULL;
+      batch[n++] = req;
+    }
+    if (q->Head[prio] == NULL)
+    {
+      q->Tail[prio] = NULL;
+    }
+  }
+  if (q->Head[STHS34PF80_BUS_PRIO_CONFIG] == NULL)
+  {
+    q->Age = 0;
+  }
+  else if (q->Age < STHS34PF80_BUS_CONFIG_AGE)
+  {
+    q->Age++;
+  }
+
+  if (n > 0U)
+  {
+    q->Stats.Depth -= (uint16_t)n;
+    q->Stats.Batches++;
+    if (n > 1U)
+    {
+      q->Stats.Shared += n;
+    }
+  }
+  return n;
+}
+
+/**
+ * @brief  Record the outcome of a request taken from the queue. The port
+ *         wakes the submitter afterwards; req may go away once it has.
+ * @param  q the queue
+ * @param  req the request
+ * @param  result STHS34PF80_OK or an error code
+ */
+void STHS34PF80_BusDone(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t *req, int32_t result)
+{
+  req->Result = result;
+  if (result != STHS34PF80_OK)
+  {
+    q->Stats.Errors++;
+  }
+}
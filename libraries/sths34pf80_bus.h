@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_BUS_H_
+#define STHS34PF80_BUS_H_
+
+#include "sths34pf80.h"
+
+/* Transaction queue for the sensors sharing one bus controller. Transfers
+ * from every instance are queued in two classes and taken in batches, the
+ * output reads first, so one owner can issue several sensors' transfers back
+ * to back under a single bus lock. The queue itself is not locked: the port
+ * serialises Push and Take, and completes the requests it takes. */
+
+/* Most requests taken at once */
+#ifndef STHS34PF80_BUS_BATCH_MAX
+#define STHS34PF80_BUS_BATCH_MAX    8U
+#endif
+
+/* Batches configuration may be passed over before it goes first */
+#ifndef STHS34PF80_BUS_CONFIG_AGE
+#define STHS34PF80_BUS_CONFIG_AGE   4U
+#endif
+
+typedef enum
+{
+    STHS34PF80_BUS_PRIO_DATA = 0,       /* STATUS, FUNC_STATUS and output reads */
+    STHS34PF80_BUS_PRIO_CONFIG,         /* everything else */
+    STHS34PF80_BUS_PRIO_NUM
+} STHS34PF80_BusPrio_t;
+
+typedef struct STHS34PF80_BusReq
+{
+    struct STHS34PF80_BusReq   *Next;
+    uint16_t                    Addr;
+    uint8_t                     Reg;
+    uint8_t                     Read;
+    uint8_t                    *Data;
+    uint16_t                    Len;
+    uint8_t                     Prio;       /* STHS34PF80_BusPrio_t */
+    int32_t                     Result;
+    void                       *Arg;        /* the port's completion */
+} STHS34PF80_BusReq_t;
+
+typedef struct
+{
+    uint32_t    Requests[STHS34PF80_BUS_PRIO_NUM];
+    uint32_t    Batches;
+    uint32_t    Shared;         /* requests taken in a batch of two or more */
+    uint32_t    Errors;
+    uint16_t    Depth;          /* requests waiting now */
+    uint16_t    PeakDepth;
+} STHS34PF80_BusStats_t;
+
+typedef struct
+{
+    STHS34PF80_BusReq_t    *Head[STHS34PF80_BUS_PRIO_NUM];
+    STHS34PF80_BusReq_t    *Tail[STHS34PF80_BUS_PRIO_NUM];
+    STHS34PF80_BusStats_t   Stats;
+    uint8_t                 Age;        /* batches taken while configuration waited */
+} STHS34PF80_BusQueue_t;
+
+void STHS34PF80_BusInit(STHS34PF80_BusQueue_t *q);
+void STHS34PF80_BusReqInit(STHS34PF80_BusReq_t *req, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                           uint8_t read, void *arg);
+void STHS34PF80_BusPush(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t *req);
+uint32_t STHS34PF80_BusTake(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t **batch, uint32_t max);
+void STHS34PF80_BusDone(STHS34PF80_BusQueue_t *q, STHS34PF80_BusReq_t *req, int32_t result);
+
+#endif /* STHS34PF80_BUS_H_ */
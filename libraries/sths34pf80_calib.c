@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_calib.h"
+#include "sths34pf80_conv.h"
+
+/**
+ * @brief  Add one sample to a streaming mean/variance accumulator
+ * @param  w the accumulator, zeroed before the first sample
+ * @param  x the sample
+ */
+void STHS34PF80_WelfordAdd(STHS34PF80_Welford_t *w, int16_t x)
+{
+  int32_t xq = (int32_t)x * 256;
+  int32_t delta;
+
+  if (w->Count >= STHS34PF80_CALIB_MAX_SAMPLES)
+  {
+    return;
+  }
+  if (w->Count == 0U || x < w->Min)
+  {
+    w->Min = x;
+  }
+  if (w->Count == 0U || x > w->Max)
+  {
+    w->Max = x;
+  }
+
+  w->Count++;
+  delta = xq - w->Mean;
+  w->Mean += delta / (int32_t)w->Count;
+  w->M2 += ((int64_t)delta * (xq - w->Mean)) / 256;
+}
+
+/**
+ * @brief  Mean of the samples so far
+ * @retval the mean in 24.8 fixed point
+ */
+int32_t STHS34PF80_WelfordMean(const STHS34PF80_Welford_t *w)
+{
+  return w->Mean;
+}
+
+/**
+ * @brief  Sample standard deviation of the samples so far
+ * @retval sigma in 24.8 fixed point, 0 with fewer than two samples
+ */
+uint32_t STHS34PF80_WelfordSigma(const STHS34PF80_Welford_t *w)
+{
+  if (w->Count < 2U || w->M2 <= 0)
+  {
+    return 0;
+  }
+
+  /* variance is 24.8, scale to 16.16 so the root comes out 24.8 */
+  return STHS34PF80_Isqrt((uint64_t)(w->M2 / (int64_t)(w->Count - 1U)) << 8);
+}
+
+/**
+ * @brief  Clear the accumulators and load the default sigma multiples
+ */
+void STHS34PF80_CalibInit(STHS34PF80_Calib_t *calib)
+{
+  memset(calib, 0, sizeof(STHS34PF80_Calib_t));
+  calib->KPresence = STHS34PF80_CALIB_K_PRESENCE;
+  calib->KMotion = STHS34PF80_CALIB_K_MOTION;
+  calib->KAmbShock = STHS34PF80_CALIB_K_AMB_SHOCK;
+}
+
+/**
+ * @brief  Accumulate the algorithm outputs of one frame
+ * @param  calib the calibration in progress
+ * @param  frame a frame read during the quiet window
+ */
+void STHS34PF80_CalibAdd(STHS34PF80_Calib_t *calib, const STHS34PF80_Frame_t *frame)
+{
+  STHS34PF80_WelfordAdd(&calib->Presence, frame->TPresence);
+  STHS34PF80_WelfordAdd(&calib->Motion, frame->TMotion);
+  STHS34PF80_WelfordAdd(&calib->AmbShock, frame->TAmbShock);
+}
+
+/**
+ * @brief  |mean| + k/10 sigma, rounded up to the largest excursion seen
+ */
+static uint16_t STHS34PF80_CalibThreshold(const STHS34PF80_Welford_t *w, uint16_t k)
+{
+  int32_t mean = STHS34PF80_WelfordMean(w);
+  uint32_t peak = (uint32_t)(-(int32_t)w->Min > w->Max ? -(int32_t)w->Min : w->Max);
+  uint64_t ths;
+
+  ths = (uint64_t)(mean < 0 ? -mean : mean) + (uint64_t)STHS34PF80_WelfordSigma(w) * k / 10U;
+  ths = (ths + 255U) >> 8;
+
+  if (ths <= peak)
+  {
+    ths = peak + 1U;
+  }
+  if (ths < STHS34PF80_CALIB_THS_MIN)
+  {
+    ths = STHS34PF80_CALIB_THS_MIN;
+  }
+  if (ths > STHS34PF80_CALIB_THS_MAX)
+  {
+    ths = STHS34PF80_CALIB_THS_MAX;
+  }
+
+  return (uint16_t)ths;
+}
+
+/**
+ * @brief  Derive the thresholds from the accumulated noise
+ * @param  calib the calibration
+ * @param  presence PRESENCE_THS result
+ * @param  motion MOTION_THS result
+ * @param  tamb_shock TAMB_SHOCK_THS result
+ * @retval STHS34PF80_OK, STHS34PF80_ERROR if the window is too short
+ */
+int32_t STHS34PF80_CalibThresholds(const STHS34PF80_Calib_t *calib, uint16_t *presence, uint16_t *motion,
+                                   uint16_t *tamb_shock)
+{
+  if (calib->Presence.Count < STHS34PF80_CALIB_MIN_SAMPLES)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  *presence = STHS34PF80_CalibThreshold(&calib->Presence, calib->KPresence);
+  *motion = STHS34PF80_CalibThreshold(&calib->Motion, calib->KMotion);
+  *tamb_shock = STHS34PF80_CalibThreshold(&calib->AmbShock, calib->KAmbShock);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Write the derived thresholds with STHS34PF80_SetThresholds, which
+ *         pauses the conversions, resets the algorithm and resumes the ODR
+ * @param  pObj the device pObj
+ * @param  calib the calibration
+ * @param  timeout wait for the conversion in progress, in GetTick units
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_CalibApply(STHS34PF80_Object_t *pObj, const STHS34PF80_Calib_t *calib, uint32_t timeout)
+{
+  uint16_t presence, motion, tamb_shock;
+
+  if (STHS34PF80_CalibThresholds(calib, &presence, &motion, &tamb_shock) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+  return STHS34PF80_SetThresholds(pObj, presence, motion, tamb_shock, timeout);
+}
+
+/**
+ * @brief  Sample a quiet window and apply the derived thresholds
+ * @param  pObj the device pObj, converting continuously
+ * @param  calib initialised with STHS34PF80_CalibInit, frames are added to it
+ * @param  samples frames to gather
+ * @param  timeout wait for each frame, in GetTick units
+ * @retval 0 in case of success, STHS34PF80_TIMEOUT if a frame did not arrive, an error code otherwise
+ */
+int32_t STHS34PF80_Calibrate(STHS34PF80_Object_t *pObj, STHS34PF80_Calib_t *calib, uint32_t samples, uint32_t timeout)
+{
+  STHS34PF80_Frame_t frame;
+  int32_t ret;
+
+  while (samples-- > 0U)
+  {
+    ret = STHS34PF80_WaitDataReady(pObj, timeout);
+    if (ret != STHS34PF80_OK)
+    {
+      return ret;
+    }
+    if (STHS34PF80_ReadFrame(pObj, &frame) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+    STHS34PF80_CalibAdd(calib, &frame);
+  }
+
+  return STHS34PF80_CalibApply(pObj, calib, timeout);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_CALIB_H_
+#define STHS34PF80_CALIB_H_
+
+#include "sths34pf80.h"
+
+/* Threshold calibration over a quiet window: TPRESENCE, TMOTION and
+ * TAMB_SHOCK are accumulated with Welford's streaming mean/variance in
+ * 24.8 fixed point, and each threshold is placed K sigma above the mean
+ * magnitude, never below the largest excursion seen in the window. */
+
+/* multiples of the noise sigma, in tenths */
+#ifndef STHS34PF80_CALIB_K_PRESENCE
+#define STHS34PF80_CALIB_K_PRESENCE     60
+#endif
+#ifndef STHS34PF80_CALIB_K_MOTION
+#define STHS34PF80_CALIB_K_MOTION       60
+#endif
+#ifndef STHS34PF80_CALIB_K_AMB_SHOCK
+#define STHS34PF80_CALIB_K_AMB_SHOCK    60
+#endif
+
+#define STHS34PF80_CALIB_THS_MIN        100U        /* stays above the default 0x32 hysteresis */
+#define STHS34PF80_CALIB_THS_MAX        0x7FFFU
+#define STHS34PF80_CALIB_MIN_SAMPLES    8U
+#define STHS34PF80_CALIB_MAX_SAMPLES    0x100000U   /* keeps M2 within 64 bits */
+
+typedef struct
+{
+    uint32_t    Count;
+    int32_t     Mean;       /* 24.8 */
+    int64_t     M2;         /* sum of squared deviations, 24.8 */
+    int16_t     Min;
+    int16_t     Max;
+} STHS34PF80_Welford_t;
+
+typedef struct
+{
+    STHS34PF80_Welford_t    Presence;
+    STHS34PF80_Welford_t    Motion;
+    STHS34PF80_Welford_t    AmbShock;
+    uint16_t                KPresence;
+    uint16_t                KMotion;
+    uint16_t                KAmbShock;
+} STHS34PF80_Calib_t;
+
+void STHS34PF80_WelfordAdd(STHS34PF80_Welford_t *w, int16_t x);
+int32_t STHS34PF80_WelfordMean(const STHS34PF80_Welford_t *w);
+uint32_t STHS34PF80_WelfordSigma(const STHS34PF80_Welford_t *w);
+
+void STHS34PF80_CalibInit(STHS34PF80_Calib_t *calib);
+void STHS34PF80_CalibAdd(STHS34PF80_Calib_t *calib, const STHS34PF80_Frame_t *frame);
+int32_t STHS34PF80_CalibThresholds(const STHS34PF80_Calib_t *calib, uint16_t *presence, uint16_t *motion,
+                                   uint16_t *tamb_shock);
+int32_t STHS34PF80_CalibApply(STHS34PF80_Object_t *pObj, const STHS34PF80_Calib_t *calib, uint32_t timeout);
+int32_t STHS34PF80_Calibrate(STHS34PF80_Object_t *pObj, STHS34PF80_Calib_t *calib, uint32_t samples, uint32_t timeout);
+
+#endif /* STHS34PF80_CALIB_H_ */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_conv.h"
+
+/**
+ * @brief  Integer square root, shifts and adds only
+ * @retval floor(sqrt(n))
+ */
+uint32_t STHS34PF80_Isqrt(uint64_t n)
+{
+  uint64_t res = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > n)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (n >= res + bit)
+    {
+      n -= res + bit;
+      res = (res >> 1) + bit;
+    }
+    else
+    {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return (uint32_t)res;
+}
+
+/**
+ * @brief  Scale a value of 100 LSB/degC
+ * @param  raw TAMBIENT or TAMB_SHOCK
+ * @param  unit the output unit
+ * @retval the value in unit
+ */
+int32_t STHS34PF80_ConvertAmbient(int16_t raw, STHS34PF80_Unit_t unit)
+{
+  int32_t val = raw;
+
+  switch (unit)
+  {
+  case STHS34PF80_UNIT_CCELSIUS:
+    return val;
+  case STHS34PF80_UNIT_DCELSIUS:
+    return STHS34PF80_DIV_ROUND(val, 10);
+  default:
+    return val;
+  }
+}
+
+/**
+ * @brief  Scale a value of 2000 LSB/degC
+ * @param  raw TOBJECT, TPRESENCE or TMOTION
+ * @param  unit the output unit
+ * @retval the value in unit
+ */
+int32_t STHS34PF80_ConvertObject(int16_t raw, STHS34PF80_Unit_t unit)
+{
+  int32_t val = raw;
+
+  switch (unit)
+  {
+  case STHS34PF80_UNIT_CCELSIUS:
+    return STHS34PF80_DIV_ROUND(val, 20);
+  case STHS34PF80_UNIT_DCELSIUS:
+    return STHS34PF80_DIV_ROUND(val, 200);
+  default:
+    return val;
+  }
+}
+
+/**
+ * @brief  TPRESENCE is computed from TOBJECT and keeps its sensitivity
+ */
+int32_t STHS34PF80_ConvertPresence(int16_t raw, STHS34PF80_Unit_t unit)
+{
+  return STHS34PF80_ConvertObject(raw, unit);
+}
+
+/**
+ * @brief  TMOTION is computed from TOBJECT and keeps its sensitivity
+ */
+int32_t STHS34PF80_ConvertMotion(int16_t raw, STHS34PF80_Unit_t unit)
+{
+  return STHS34PF80_ConvertObject(raw, unit);
+}
+
+/**
+ * @brief  TAMB_SHOCK is computed from TAMBIENT and keeps its sensitivity
+ */
+int32_t STHS34PF80_ConvertAmbShock(int16_t raw, STHS34PF80_Unit_t unit)
+{
+  return STHS34PF80_ConvertAmbient(raw, unit);
+}
+
+/**
+ * @brief  Object temperature from TOBJECT compensated for the ambient temperature
+ *
+ * TOBJECT is proportional to the radiated power difference Tobj^4 - Tamb^4
+ * and its 2000 LSB/degC sensitivity holds at 25 degC, so
+ * Tobj^4 = Tamb^4 + 4 * Tref^3 * TOBJECT / 2000, solved in 0.01 K with
+ * 64-bit integers. The object is taken as a black body.
+ * @param  tobject TOBJECT
+ * @param  tambient TAMBIENT of the same ODR cycle
+ * @param  unit the output unit, STHS34PF80_UNIT_RAW gives 0.01 degC as well
+ * @retval the object temperature in unit
+ */
+int32_t STHS34PF80_CompensateObject(int16_t tobject, int16_t tambient, STHS34PF80_Unit_t unit)
+{
+  /* 4 * Tref^3 / (2000 LSB/degC * 0.01) = 5963 * 29815^2, exact */
+  const uint64_t flux_per_lsb = (uint64_t)(STHS34PF80_TOBJECT_REF_CK / 5) *
+                                STHS34PF80_TOBJECT_REF_CK * STHS34PF80_TOBJECT_REF_CK;
+  int32_t tamb_ck = (int32_t)tambient + STHS34PF80_KELVIN_CC;
+  uint64_t t4, flux, lo, hi;
+  uint32_t root;
+  int32_t tobj_cc;
+
+  if (tamb_ck < 0)
+  {
+    tamb_ck = 0;
+  }
+  t4 = (uint64_t)tamb_ck * (uint64_t)tamb_ck;
+  t4 *= t4;
+
+  if (tobject >= 0)
+  {
+    t4 += flux_per_lsb * (uint64_t)tobject;
+  }
+  else
+  {
+    flux = flux_per_lsb * (uint64_t)(-(int32_t)tobject);
+    t4 = (t4 > flux) ? t4 - flux : 0;
+  }
+
+  /* nested floor roots give floor(t4^(1/4)), round to the nearer fourth power */
+  root = STHS34PF80_Isqrt(STHS34PF80_Isqrt(t4));
+  lo = (uint64_t)root * root;
+  hi = (uint64_t)(root + 1) * (root + 1);
+  if (hi * hi - t4 < t4 - lo * lo)
+  {
+    root++;
+  }
+  tobj_cc = (int32_t)root - STHS34PF80_KELVIN_CC;
+
+  if (unit == STHS34PF80_UNIT_DCELSIUS)
+  {
+    return STHS34PF80_DIV_ROUND(tobj_cc, 10);
+  }
+  return tobj_cc;
+}
+
+/**
+ * @brief  Convert every output of a frame to one unit
+ * @param  frame as read by STHS34PF80_ReadFrame
+ * @param  unit the output unit
+ * @param  values the converted outputs
+ */
+void STHS34PF80_ConvertFrame(const STHS34PF80_Frame_t *frame, STHS34PF80_Unit_t unit, STHS34PF80_Values_t *values)
+{
+  values->TObject = STHS34PF80_ConvertObject(frame->TObject, unit);
+  values->TAmbient = STHS34PF80_ConvertAmbient(frame->TAmbient, unit);
+  values->TPresence = STHS34PF80_ConvertPresence(frame->TPresence, unit);
+  values->TMotion = STHS34PF80_ConvertMotion(frame->TMotion, unit);
+  values->TAmbShock = STHS34PF80_ConvertAmbShock(frame->TAmbShock, unit);
+}
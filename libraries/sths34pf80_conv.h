@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_CONV_H_
+#define STHS34PF80_CONV_H_
+
+#include "sths34pf80.h"
+
+/* Integer conversion of the 16-bit two's complement outputs. Every divisor
+ * is a constant, so no float support or hardware divider is needed. */
+
+#define STHS34PF80_TAMBIENT_LSB_PER_C   100     /* TAMBIENT and TAMB_SHOCK */
+#define STHS34PF80_TOBJECT_LSB_PER_C    2000    /* TOBJECT, TPRESENCE and TMOTION */
+#define STHS34PF80_TOBJECT_REF_CK       29815   /* 25 degC in 0.01 K, where TOBJECT is linearised */
+#define STHS34PF80_KELVIN_CC            27315   /* 0 degC in 0.01 K */
+
+typedef enum
+{
+    STHS34PF80_UNIT_RAW = 0,        /* output LSB, sign extended */
+    STHS34PF80_UNIT_CCELSIUS,       /* 0.01 degC */
+    STHS34PF80_UNIT_DCELSIUS,       /* 0.1 degC */
+} STHS34PF80_Unit_t;
+
+typedef struct
+{
+    int32_t     TObject;
+    int32_t     TAmbient;
+    int32_t     TPresence;
+    int32_t     TMotion;
+    int32_t     TAmbShock;
+} STHS34PF80_Values_t;
+
+/* n / d rounded half away from zero, d a positive constant */
+#define STHS34PF80_DIV_ROUND(n, d)      (((n) >= 0) ? (((n) + (d) / 2) / (d)) : (((n) - (d) / 2) / (d)))
+
+int32_t STHS34PF80_ConvertAmbient(int16_t raw, STHS34PF80_Unit_t unit);
+int32_t STHS34PF80_ConvertObject(int16_t raw, STHS34PF80_Unit_t unit);
+int32_t STHS34PF80_ConvertPresence(int16_t raw, STHS34PF80_Unit_t unit);
+int32_t STHS34PF80_ConvertMotion(int16_t raw, STHS34PF80_Unit_t unit);
+int32_t STHS34PF80_ConvertAmbShock(int16_t raw, STHS34PF80_Unit_t unit);
+int32_t STHS34PF80_CompensateObject(int16_t tobject, int16_t tambient, STHS34PF80_Unit_t unit);
+uint32_t STHS34PF80_Isqrt(uint64_t n);
+void STHS34PF80_ConvertFrame(const STHS34PF80_Frame_t *frame, STHS34PF80_Unit_t unit, STHS34PF80_Values_t *values);
+
+#endif /* STHS34PF80_CONV_H_ */
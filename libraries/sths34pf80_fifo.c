@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_fifo.h"
+
+#define STHS34PF80_FIFO_MASK    (STHS34PF80_FIFO_DEPTH - 1U)
+
+/**
+ * @brief  Empty the FIFO. Only call while neither side is running, e.g. from
+ *         the consumer with the producer held off by a lock
+ * @param  fifo the FIFO
+ */
+void STHS34PF80_FifoReset(STHS34PF80_Fifo_t *fifo)
+{
+  fifo->Head = 0;
+  fifo->Tail = 0;
+  fifo->Dropped = 0;
+}
+
+/**
+ * @brief  Get the number of samples waiting, callable from either side
+ * @param  fifo the FIFO
+ * @retval number of samples
+ */
+uint32_t STHS34PF80_FifoCount(STHS34PF80_Fifo_t *fifo)
+{
+  /* free-running indexes, unsigned wrap gives the fill level */
+  return fifo->Head - fifo->Tail;
+}
+
+/**
+ * @brief  Append one sample, producer side only
+ * @param  fifo the FIFO
+ * @param  sample the sample to copy in
+ * @retval 0 in case of success, an error code if the FIFO is full
+ */
+int32_t STHS34PF80_FifoPush(STHS34PF80_Fifo_t *fifo, const STHS34PF80_Sample_t *sample)
+{
+  uint32_t head = fifo->Head;
+
+  if ((head - fifo->Tail) >= STHS34PF80_FIFO_DEPTH)
+  {
+    fifo->Dropped++;
+    return STHS34PF80_ERROR;
+  }
+
+  fifo->Buf[head & STHS34PF80_FIFO_MASK] = *sample;
+  STHS34PF80_FIFO_BARRIER();
+  fifo->Head = head + 1U;
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Remove up to max samples, consumer side only
+ * @param  fifo the FIFO
+ * @param  samples destination array
+ * @param  max capacity of samples
+ * @retval number of samples copied out
+ */
+uint32_t STHS34PF80_FifoPop(STHS34PF80_Fifo_t *fifo, STHS34PF80_Sample_t *samples, uint32_t max)
+{
+  uint32_t tail = fifo->Tail;
+  uint32_t count = fifo->Head - tail;
+  uint32_t i;
+
+  if (count > max)
+  {
+    count = max;
+  }
+
+  STHS34PF80_FIFO_BARRIER();
+  for (i = 0; i < count; i++)
+  {
+    samples[i] = fifo->Buf[(tail + i) & STHS34PF80_FIFO_MASK];
+  }
+  STHS34PF80_FIFO_BARRIER();
+  fifo->Tail = tail + count;
+
+  return count;
+}
+
+/**
+ * @brief  Get the number of samples the consumer may read in place with
+ *         STHS34PF80_FifoAt, consumer side only
+ * @param  fifo the FIFO
+ * @retval number of samples
+ */
+uint32_t STHS34PF80_FifoPeek(STHS34PF80_Fifo_t *fifo)
+{
+  uint32_t count = fifo->Head - fifo->Tail;
+
+  /* slots up to Head are complete once Head is seen */
+  STHS34PF80_FIFO_BARRIER();
+  return count;
+}
+
+/**
+ * @brief  Access a waiting sample without copying it out, consumer side only.
+ *         The slot stays valid until it is released.
+ * @param  fifo the FIFO
+ * @param  n index from the oldest sample, below STHS34PF80_FifoPeek
+ * @retval the sample
+ */
+const STHS34PF80_Sample_t *STHS34PF80_FifoAt(const STHS34PF80_Fifo_t *fifo, uint32_t n)
+{
+  return &fifo->Buf[(fifo->Tail + n) & STHS34PF80_FIFO_MASK];
+}
+
+/**
+ * @brief  Hand the oldest samples read in place back to the producer,
+ *         consumer side only
+ * @param  fifo the FIFO
+ * @param  count number of samples, at most STHS34PF80_FifoPeek
+ */
+void STHS34PF80_FifoRelease(STHS34PF80_Fifo_t *fifo, uint32_t count)
+{
+  /* done reading the slots before the producer may reuse them */
+  STHS34PF80_FIFO_BARRIER();
+  fifo->Tail += count;
+}
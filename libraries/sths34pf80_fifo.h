@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_FIFO_H_
+#define STHS34PF80_FIFO_H_
+
+#include "sths34pf80.h"
+
+/* Number of samples per software FIFO, must be a power of two */
+#ifndef STHS34PF80_FIFO_DEPTH
+#define STHS34PF80_FIFO_DEPTH       16U
+#endif
+
+#if (STHS34PF80_FIFO_DEPTH & (STHS34PF80_FIFO_DEPTH - 1U)) != 0U
+#error "STHS34PF80_FIFO_DEPTH must be a power of two"
+#endif
+
+/* Orders the slot access against the index update seen by the other side */
+#if defined(__GNUC__) || defined(__clang__)
+#define STHS34PF80_FIFO_BARRIER()   __sync_synchronize()
+#elif defined(__CC_ARM)
+#define STHS34PF80_FIFO_BARRIER()   __dmb(0xF)
+#else
+#define STHS34PF80_FIFO_BARRIER()
+#endif
+
+typedef struct
+{
+    uint32_t               Timestamp;
+    STHS34PF80_Frame_t     Frame;
+} STHS34PF80_Sample_t;
+
+/* Single-producer/single-consumer ring. Head is only written by the producer
+ * and Tail only by the consumer, so neither side needs a lock. */
+typedef struct
+{
+    volatile uint32_t      Head;
+    volatile uint32_t      Tail;
+    volatile uint32_t      Dropped;    /* samples rejected because the ring was full */
+    STHS34PF80_Sample_t    Buf[STHS34PF80_FIFO_DEPTH];
+} STHS34PF80_Fifo_t;
+
+void STHS34PF80_FifoReset(STHS34PF80_Fifo_t *fifo);
+uint32_t STHS34PF80_FifoCount(STHS34PF80_Fifo_t *fifo);
+int32_t STHS34PF80_FifoPush(STHS34PF80_Fifo_t *fifo, const STHS34PF80_Sample_t *sample);
+uint32_t STHS34PF80_FifoPop(STHS34PF80_Fifo_t *fifo, STHS34PF80_Sample_t *samples, uint32_t max);
+uint32_t STHS34PF80_FifoPeek(STHS34PF80_Fifo_t *fifo);
+const STHS34PF80_Sample_t *STHS34PF80_FifoAt(const STHS34PF80_Fifo_t *fifo, uint32_t n);
+void STHS34PF80_FifoRelease(STHS34PF80_Fifo_t *fifo, uint32_t count);
+
+#endif /* STHS34PF80_FIFO_H_ */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_gov.h"
+
+/**
+ * @brief  Start governing at the current ODR, which becomes the active one.
+ *         The sensor steps down once the first quiet period has passed.
+ * @param  gov the governor
+ * @param  pObj the device pObj, initialised
+ * @param  quiet_ticks activity-free time before stepping down, in GetTick
+ *         units, or in frames when the IO has no GetTick
+ */
+void STHS34PF80_GovInit(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, uint32_t quiet_ticks)
+{
+  memset(gov, 0, sizeof(STHS34PF80_Gov_t));
+  gov->ActiveODR = pObj->Config.ODR;
+  gov->IdleODR = STHS34PF80_GOV_IDLE_ODR < gov->ActiveODR ? STHS34PF80_GOV_IDLE_ODR : gov->ActiveODR;
+  gov->Approach = STHS34PF80_GOV_APPROACH;
+  gov->Active = 1;
+  gov->QuietTicks = quiet_ticks;
+  gov->LastActivity = pObj->IO.GetTick != NULL ? (uint32_t)pObj->IO.GetTick() : 0U;
+}
+
+/**
+ * @brief  Whether a frame shows activity: a presence or motion flag, or
+ *         TPRESENCE/TMOTION at Approach percent of their thresholds
+ * @retval 1 on activity, 0 otherwise
+ */
+uint8_t STHS34PF80_GovActivity(const STHS34PF80_Gov_t *gov, const STHS34PF80_Object_t *pObj,
+                               const STHS34PF80_Frame_t *frame)
+{
+  int32_t presence = frame->TPresence < 0 ? -(int32_t)frame->TPresence : frame->TPresence;
+  int32_t motion = frame->TMotion < 0 ? -(int32_t)frame->TMotion : frame->TMotion;
+
+  if ((frame->FuncStatus & (STHS34PF80_EVENT_PRESENCE | STHS34PF80_EVENT_MOTION)) != 0U)
+  {
+    return 1;
+  }
+  return (presence * 100 >= (int32_t)pObj->Config.THS_Presence * gov->Approach ||
+          motion * 100 >= (int32_t)pObj->Config.THS_Motion * gov->Approach) ? 1U : 0U;
+}
+
+/**
+ * @brief  Account for one frame and switch ODR when the activity calls for it.
+ *         Call right after the frame was read, the switch relies on it.
+ * @param  gov the governor
+ * @param  pObj the device pObj
+ * @param  frame the frame just read
+ * @retval 0 in case of success, an error code if a switch failed
+ */
+int32_t STHS34PF80_GovUpdate(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, const STHS34PF80_Frame_t *frame)
+{
+  uint32_t now;
+
+  gov->Frames++;
+  now = pObj->IO.GetTick != NULL ? (uint32_t)pObj->IO.GetTick() : gov->Frames;
+
+  if (STHS34PF80_GovActivity(gov, pObj, frame))
+  {
+    gov->LastActivity = now;
+    if (!gov->Active)
+    {
+      if (STHS34PF80_SetODR(pObj, gov->ActiveODR, 0) != STHS34PF80_OK)
+      {
+        return STHS34PF80_ERROR;
+      }
+      gov->Active = 1;
+      gov->StepsUp++;
+    }
+  }
+  else if (gov->Active && gov->IdleODR != gov->ActiveODR && now - gov->LastActivity >= gov->QuietTicks)
+  {
+    if (STHS34PF80_SetODR(pObj, gov->IdleODR, 0) != STHS34PF80_OK)
+    {
+      return STHS34PF80_ERROR;
+    }
+    gov->Active = 0;
+    gov->StepsDown++;
+  }
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Change the active ODR, the idle one is kept at or below it
+ * @param  gov the governor
+ * @param  pObj the device pObj
+ * @param  odr the ODR code
+ * @param  timeout see STHS34PF80_SetODR
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_GovSetActiveODR(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout)
+{
+  uint8_t idle = STHS34PF80_GOV_IDLE_ODR < odr ? STHS34PF80_GOV_IDLE_ODR : odr;
+
+  if (odr == 0 || odr > STHS34PF80_MaxODR(pObj->Config.AVG_TMOS))
+  {
+    return STHS34PF80_ERROR;
+  }
+  if (STHS34PF80_SetODR(pObj, gov->Active ? odr : idle, timeout) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  gov->ActiveODR = odr;
+  gov->IdleODR = idle;
+  return STHS34PF80_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_GOV_H_
+#define STHS34PF80_GOV_H_
+
+#include "sths34pf80.h"
+
+/* Adaptive ODR governor. Fed with every frame, it keeps the sensor at a low
+ * idle ODR while nothing is detected, steps up to the active ODR as soon as
+ * a presence or motion flag fires or TPRESENCE/TMOTION come within reach of
+ * their thresholds, and steps back down after a quiet period. Switches are
+ * made right after the frame was read, on a conversion boundary, so they
+ * never wait for DRDY. */
+
+#ifndef STHS34PF80_GOV_IDLE_ODR
+#define STHS34PF80_GOV_IDLE_ODR     0x03U   /* 1 Hz */
+#endif
+#ifndef STHS34PF80_GOV_APPROACH
+#define STHS34PF80_GOV_APPROACH     50U     /* step up at this percentage of a threshold */
+#endif
+
+typedef struct
+{
+    uint8_t     IdleODR;
+    uint8_t     ActiveODR;
+    uint8_t     Approach;       /* percent */
+    uint8_t     Active;         /* running at ActiveODR */
+    uint32_t    QuietTicks;     /* GetTick units, frames when there is no GetTick */
+    uint32_t    LastActivity;
+    uint32_t    Frames;
+    uint32_t    StepsUp;
+    uint32_t    StepsDown;
+} STHS34PF80_Gov_t;
+
+void STHS34PF80_GovInit(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, uint32_t quiet_ticks);
+uint8_t STHS34PF80_GovActivity(const STHS34PF80_Gov_t *gov, const STHS34PF80_Object_t *pObj,
+                               const STHS34PF80_Frame_t *frame);
+int32_t STHS34PF80_GovUpdate(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, const STHS34PF80_Frame_t *frame);
+int32_t STHS34PF80_GovSetActiveODR(STHS34PF80_Gov_t *gov, STHS34PF80_Object_t *pObj, uint8_t odr, uint32_t timeout);
+
+#endif /* STHS34PF80_GOV_H_ */
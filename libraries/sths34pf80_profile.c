@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_profile.h"
+
+/*                                       LPF_M  LPF_P  LPF_T  AVG    ODR    THS_M  THS_P  THS_S */
+static const STHS34PF80_Profile_t profiles[STHS34PF80_PROFILE_NUM] =
+{
+  { "default",          STHS34PF80_IMAGE(0x04,  0x04,  0x02,  0x02,  0x07,  2300,  5000,  2000) },
+  /* ODR/9 and ODR/20 keep the response time in seconds at 1 Hz */
+  { "low-power",        STHS34PF80_IMAGE(0x00,  0x01,  0x00,  0x02,  0x03,  2300,  5000,  2000) },
+  /* less averaging is noisier, motion needs more margin */
+  { "fast-response",    STHS34PF80_IMAGE(0x01,  0x02,  0x02,  0x01,  0x08,  3000,  5000,  2000) },
+  /* AVG_TMOS 256 lowers the noise enough for lower thresholds */
+  { "high-sensitivity", STHS34PF80_IMAGE(0x01,  0x02,  0x02,  0x04,  0x05,  1000,  2000,  1000) },
+};
+
+/**
+ * @brief  Look up a profile
+ * @retval the profile, NULL if id is out of range
+ */
+const STHS34PF80_Profile_t *STHS34PF80_ProfileGet(STHS34PF80_ProfileId_t id)
+{
+  return (uint32_t)id < STHS34PF80_PROFILE_NUM ? &profiles[id] : NULL;
+}
+
+/**
+ * @brief  Look up a profile by name
+ * @retval the profile, NULL if there is none of that name
+ */
+const STHS34PF80_Profile_t *STHS34PF80_ProfileFind(const char *name)
+{
+  uint32_t i;
+
+  for (i = 0; i < STHS34PF80_PROFILE_NUM; i++)
+  {
+    if (strcmp(profiles[i].Name, name) == 0)
+    {
+      return &profiles[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief  Program a profile and make it the current configuration
+ * @param  pObj the device pObj
+ * @param  id the profile
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_ApplyProfile(STHS34PF80_Object_t *pObj, STHS34PF80_ProfileId_t id)
+{
+  const STHS34PF80_Profile_t *profile = STHS34PF80_ProfileGet(id);
+
+  if (profile == NULL)
+  {
+    return STHS34PF80_ERROR;
+  }
+  return STHS34PF80_ApplyImage(pObj, &(profile->Image));
+}
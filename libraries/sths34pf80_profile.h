@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_PROFILE_H_
+#define STHS34PF80_PROFILE_H_
+
+#include "sths34pf80.h"
+
+/* Named configurations, each a constant register image built at compile
+ * time. Applying one costs the burst writes of sths34pf80_image_write and
+ * no reads, so profiles can also be switched at runtime. */
+
+typedef enum
+{
+    STHS34PF80_PROFILE_DEFAULT = 0,         /* 15 Hz, the driver defaults */
+    STHS34PF80_PROFILE_LOW_POWER,           /* 1 Hz */
+    STHS34PF80_PROFILE_FAST_RESPONSE,       /* 30 Hz, short filters */
+    STHS34PF80_PROFILE_HIGH_SENSITIVITY,    /* 4 Hz, heavy averaging, low thresholds */
+    STHS34PF80_PROFILE_NUM
+} STHS34PF80_ProfileId_t;
+
+typedef struct
+{
+    const char         *Name;
+    sths34pf80_image_t  Image;
+} STHS34PF80_Profile_t;
+
+const STHS34PF80_Profile_t *STHS34PF80_ProfileGet(STHS34PF80_ProfileId_t id);
+const STHS34PF80_Profile_t *STHS34PF80_ProfileFind(const char *name);
+int32_t STHS34PF80_ApplyProfile(STHS34PF80_Object_t *pObj, STHS34PF80_ProfileId_t id);
+
+#endif /* STHS34PF80_PROFILE_H_ */
@@ -43,6 +43,166 @@ int32_t sths34pf80_write_reg(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *data,
     return ret;
 }
 
+/* Cached control registers: bit in sths34pf80_shadow_t.valid */
+#define STHS34PF80_SHADOW_LPF1      (1U << 0)
+#define STHS34PF80_SHADOW_LPF2      (1U << 1)
+#define STHS34PF80_SHADOW_AVG_TRIM  (1U << 2)
+#define STHS34PF80_SHADOW_CTRL1     (1U << 3)
+#define STHS34PF80_SHADOW_CTRL2     (1U << 4)
+#define STHS34PF80_SHADOW_CTRL3     (1U << 5)
+#define STHS34PF80_SHADOW_ALL       (0x3FU)
+
+/* CTRL2 bits cleared by the device itself (ONE_SHOT, BOOT), never cached */
+#define STHS34PF80_CTRL2_SELF_CLEAR (0x81U)
+
+static uint8_t *sths34pf80_shadow_slot(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *bit)
+{
+    sths34pf80_shadow_t *shadow = ctx->shadow;
+
+    if (shadow == RT_NULL)
+    {
+        return RT_NULL;
+    }
+
+    switch (reg)
+    {
+    case STHS34PF80_LPF1:
+        *bit = STHS34PF80_SHADOW_LPF1;
+        return &shadow->lpf1;
+    case STHS34PF80_LPF2:
+        *bit = STHS34PF80_SHADOW_LPF2;
+        return &shadow->lpf2;
+    case STHS34PF80_AVG_TRIM:
+        *bit = STHS34PF80_SHADOW_AVG_TRIM;
+        return &shadow->avg_trim;
+    case STHS34PF80_CTRL1:
+        *bit = STHS34PF80_SHADOW_CTRL1;
+        return &shadow->ctrl1;
+    case STHS34PF80_CTRL2:
+        *bit = STHS34PF80_SHADOW_CTRL2;
+        return &shadow->ctrl2;
+    case STHS34PF80_CTRL3:
+        *bit = STHS34PF80_SHADOW_CTRL3;
+        return &shadow->ctrl3;
+    default:
+        return RT_NULL;
+    }
+}
+
+static void sths34pf80_shadow_store(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t val)
+{
+    uint8_t bit;
+    uint8_t *slot = sths34pf80_shadow_slot(ctx, reg, &bit);
+
+    if (slot != RT_NULL)
+    {
+        if (reg == STHS34PF80_CTRL2)
+        {
+            val &= (uint8_t)~STHS34PF80_CTRL2_SELF_CLEAR;
+        }
+        *slot = val;
+        ctx->shadow->valid |= bit;
+    }
+}
+
+/**
+  * @brief  Read a control register, served from the shadow cache when valid
+*/
+static int32_t sths34pf80_shadow_read(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *val)
+{
+    int32_t ret;
+    uint8_t bit;
+    uint8_t *slot = sths34pf80_shadow_slot(ctx, reg, &bit);
+
+    if ((slot != RT_NULL) && (ctx->shadow->valid & bit))
+    {
+        *val = *slot;
+        return RT_EOK;
+    }
+
+    ret = sths34pf80_read_reg(ctx, reg, val, 1);
+    if (ret == RT_EOK)
+    {
+        sths34pf80_shadow_store(ctx, reg, *val);
+    }
+    return ret;
+}
+
+/**
+  * @brief  Write a control register and keep the shadow cache in step
+*/
+static int32_t sths34pf80_shadow_write(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t val)
+{
+    int32_t ret;
+    uint8_t bit;
+
+    ret = sths34pf80_write_reg(ctx, reg, &val, 1);
+    if (ret == RT_EOK)
+    {
+        sths34pf80_shadow_store(ctx, reg, val);
+    }
+    else if (sths34pf80_shadow_slot(ctx, reg, &bit) != RT_NULL)
+    {
+        /* the device state is unknown after a failed write */
+        ctx->shadow->valid &= (uint8_t)~bit;
+    }
+    return ret;
+}
+
+/**
+  * @brief  Drop every cached control register, next access goes to the bus
+*/
+void sths34pf80_shadow_invalidate(sths34pf80_ctx_t *ctx)
+{
+    if (ctx->shadow != RT_NULL)
+    {
+        ctx->shadow->valid = 0;
+    }
+}
+
+/**
+  * @brief  Cached value of a control register, read from the bus only when not cached
+*/
+int32_t sths34pf80_shadow_get(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *val)
+{
+    return sths34pf80_shadow_read(ctx, reg, val);
+}
+
+/**
+  * @brief  Reload the shadow cache from the device (two burst reads)
+*/
+int32_t sths34pf80_shadow_sync(sths34pf80_ctx_t *ctx)
+{
+    int32_t ret;
+    uint8_t buf[5];
+
+    if (ctx->shadow == RT_NULL)
+    {
+        return RT_EOK;
+    }
+
+    sths34pf80_shadow_invalidate(ctx);
+
+    /* LPF1, LPF2, reserved, WHO_AM_I, AVG_TRIM */
+    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF1, buf, 5);
+    if (ret == RT_EOK)
+    {
+        sths34pf80_shadow_store(ctx, STHS34PF80_LPF1, buf[0]);
+        sths34pf80_shadow_store(ctx, STHS34PF80_LPF2, buf[1]);
+        sths34pf80_shadow_store(ctx, STHS34PF80_AVG_TRIM, buf[4]);
+
+        /* CTRL1, CTRL2, CTRL3 */
+        ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL1, buf, 3);
+    }
+    if (ret == RT_EOK)
+    {
+        sths34pf80_shadow_store(ctx, STHS34PF80_CTRL1, buf[0]);
+        sths34pf80_shadow_store(ctx, STHS34PF80_CTRL2, buf[1]);
+        sths34pf80_shadow_store(ctx, STHS34PF80_CTRL3, buf[2]);
+    }
+    return ret;
+}
+
 /**
   * @brief  Low-pass filter configuration for motion and presence detection
 */
@@ -51,11 +211,11 @@ int32_t sths34pf80_lpf_presence_motion_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF1, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_LPF1, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.lpf1.lpf_p_m = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_LPF1, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_LPF1, reg.byte);
     }
     return ret;
 }
@@ -78,11 +238,11 @@ int32_t sths34pf80_lpf_motion_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF1, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_LPF1, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.lpf1.lpf_m = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_LPF1, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_LPF1, reg.byte);
     }
     return ret;
 }
@@ -106,11 +266,11 @@ int32_t sths34pf80_lpf_presence_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_LPF2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.lpf2.lpf_p = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_LPF2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_LPF2, reg.byte);
     }
     return ret;
 }
@@ -134,11 +294,11 @@ int32_t sths34pf80_lpf_temperature_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_LPF2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.lpf2.lpf_a_t = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_LPF2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_LPF2, reg.byte);
     }
     return ret;
 }
@@ -176,11 +336,11 @@ int32_t sths34pf80_avg_trim_avg_t_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_AVG_TRIM, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_AVG_TRIM, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.avg_trim.avg_t = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_AVG_TRIM, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_AVG_TRIM, reg.byte);
     }
     return ret;
 }
@@ -204,11 +364,11 @@ int32_t sths34pf80_avg_trim_avg_tmos_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_AVG_TRIM, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_AVG_TRIM, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.avg_trim.avg_tmos = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_AVG_TRIM, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_AVG_TRIM, reg.byte);
     }
     return ret;
 }
@@ -232,11 +392,11 @@ int32_t sths34pf80_ctrl1_bdu_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL1, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg1.bdu = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL1, reg.byte);
     }
     return ret;
 }
@@ -260,11 +420,11 @@ int32_t sths34pf80_ctrl1_odr_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL1, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg1.odr = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL1, reg.byte);
     }
     return ret;
 }
@@ -274,7 +434,8 @@ int32_t sths34pf80_ctrl1_odr_get(sths34pf80_ctx_t *ctx, uint8_t *val)
   sths34pf80_reg_t reg;
   int32_t ret;
 
-  ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
+  /* CTRL1 only changes on host writes, the cached copy is authoritative */
+  ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL1, &(reg.byte));
   *val = reg.ctrl_reg1.odr;
 
   return ret;
@@ -288,11 +449,11 @@ int32_t sths34pf80_ctrl2_boot_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg2.boot = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL2, reg.byte);
     }
     return ret;
 }
@@ -316,11 +477,11 @@ int32_t sths34pf80_ctrl2_func_cfg_access_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg2.func_cfg_access = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL2, reg.byte);
     }
     return ret;
 }
@@ -344,11 +505,11 @@ int32_t sths34pf80_ctrl2_one_shot_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg2.one_shot = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL2, reg.byte);
     }
     return ret;
 }
@@ -372,11 +533,11 @@ int32_t sths34pf80_ctrl3_int_h_l_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.int_h_l = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -400,11 +561,11 @@ int32_t sths34pf80_ctrl3_int_msk0_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.int_msk0 = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -425,11 +586,11 @@ int32_t sths34pf80_ctrl3_int_msk1_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.int_msk1 = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -450,11 +611,11 @@ int32_t sths34pf80_ctrl3_int_msk2_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.int_msk2 = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -479,11 +640,11 @@ int32_t sths34pf80_ctrl3_pp_od_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.pp_od = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -507,11 +668,11 @@ int32_t sths34pf80_ctrl3_ien_set(sths34pf80_ctx_t *ctx, uint8_t val)
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL3, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg3.ien = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL3, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, reg.byte);
     }
     return ret;
 }
@@ -527,6 +688,14 @@ int32_t sths34pf80_ctrl3_ien_get(sths34pf80_ctx_t *ctx, uint8_t *val)
   return ret;
 }
 
+/**
+  * @brief  Write the whole of CTRL3: INT routing, masks, output type and polarity
+*/
+int32_t sths34pf80_ctrl3_set(sths34pf80_ctx_t *ctx, uint8_t val)
+{
+    return sths34pf80_shadow_write(ctx, STHS34PF80_CTRL3, val);
+}
+
 /**
   * @brief  Data ready for TAMB, TOBJ, TAMB_SHOCK, TPRESENCE, TMOTION.
   * @brief  This bit is reset to 0 when reading the FUNC_STATUS (25h)register.
@@ -678,85 +847,302 @@ int32_t sths34pf80_tamb_shock_get(sths34pf80_ctx_t *ctx, uint16_t *val)
 }
 
 /**
-  * @brief  Threshold for detection algorithms. This value is 15-bit unsigned
+  * @brief  Read TOBJECT_L (26h) through TAMBIENT_H (29h) in one transfer so that both temperatures
+  * belong to the same ODR cycle. buf must hold 4 bytes. FUNC_STATUS is not read.
 */
-int32_t sths34pf80_threshold_set(sths34pf80_ctx_t *ctx,uint8_t addr,uint8_t val)
+
+int32_t sths34pf80_object_ambient_get(sths34pf80_ctx_t *ctx, uint8_t *buf)
+{
+  return sths34pf80_read_reg(ctx, STHS34PF80_TOBJECT_L, buf, 4);
+}
+
+/**
+  * @brief  Read STATUS (23h) through TAMB_SHOCK_H (3Fh) in one transfer so that every output
+  * belongs to the same ODR cycle. buf must hold STHS34PF80_OUTPUT_BLOCK_LEN bytes.
+  * Reading FUNC_STATUS (25h) as part of the block clears DRDY and the detection flags.
+*/
+
+int32_t sths34pf80_output_block_get(sths34pf80_ctx_t *ctx, uint8_t *buf)
+{
+  return sths34pf80_read_reg(ctx, STHS34PF80_STATUS, buf, STHS34PF80_OUTPUT_BLOCK_LEN);
+}
+
+/**
+  * @brief  Open an embedded function page session. mode is STHS34PF80_FUNC_CFG_WRITE
+  * @brief  or STHS34PF80_FUNC_CFG_READ, addr the first embedded register to access.
+  * @brief  FUNC_CFG_ADDR auto-increments on every FUNC_CFG_DATA access until the session is closed.
+*/
+int32_t sths34pf80_func_cfg_open(sths34pf80_ctx_t *ctx, uint8_t mode, uint8_t addr)
 {
     sths34pf80_reg_t reg;
     int32_t ret;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+    ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL2, &(reg.byte));
     if (ret == RT_EOK)
     {
         reg.ctrl_reg2.func_cfg_access = 1;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL2, reg.byte);
     }
     if (ret == RT_EOK)
     {
-        reg.byte = 0x40;
+        reg.byte = mode;
         ret = sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1);
     }
     if (ret == RT_EOK)
     {
         reg.byte = addr;
-        ret = sths34pf80_write_reg(ctx,STHS34PF80_FUNC_CFG_ADDR , &(reg.byte), 1);
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_ADDR, &(reg.byte), 1);
     }
+    return ret;
+}
+
+/**
+  * @brief  Close the embedded function page session and return to the main register page
+*/
+int32_t sths34pf80_func_cfg_close(sths34pf80_ctx_t *ctx)
+{
+    sths34pf80_reg_t reg;
+    int32_t ret;
+
+    reg.byte = 0;
+    ret = sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1);
     if (ret == RT_EOK)
     {
-        reg.byte = val;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_DATA, &(reg.byte), 1);
+        ret = sths34pf80_shadow_read(ctx, STHS34PF80_CTRL2, &(reg.byte));
     }
     if (ret == RT_EOK)
     {
-        reg.byte = 0;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1);
+        reg.ctrl_reg2.func_cfg_access = 0;
+        ret = sths34pf80_shadow_write(ctx, STHS34PF80_CTRL2, reg.byte);
     }
-    if (ret == RT_EOK)
+    return ret;
+}
+
+/**
+  * @brief  Write len contiguous embedded function registers starting at addr in one session
+*/
+int32_t sths34pf80_func_cfg_write(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t *data, uint16_t len)
+{
+    int32_t ret;
+    uint16_t i;
+
+    ret = sths34pf80_func_cfg_open(ctx, STHS34PF80_FUNC_CFG_WRITE, addr);
+    for (i = 0; (ret == RT_EOK) && (i < len); i++)
     {
-        reg.ctrl_reg2.func_cfg_access = 0;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_DATA, &data[i], 1);
+    }
+
+    /* always leave the embedded page, even after a failed access */
+    if (sths34pf80_func_cfg_close(ctx) != RT_EOK)
+    {
+        ret = -RT_ERROR;
     }
     return ret;
 }
 
-int32_t sths34pf80_threshold_get(sths34pf80_ctx_t *ctx,uint8_t addr,uint8_t *val)
+/**
+  * @brief  Read len contiguous embedded function registers starting at addr in one session
+*/
+int32_t sths34pf80_func_cfg_read(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t *data, uint16_t len)
+{
+    int32_t ret;
+    uint16_t i;
+
+    ret = sths34pf80_func_cfg_open(ctx, STHS34PF80_FUNC_CFG_READ, addr);
+    for (i = 0; (ret == RT_EOK) && (i < len); i++)
+    {
+        ret = sths34pf80_read_reg(ctx, STHS34PF80_FUNC_CFG_DATA, &data[i], 1);
+    }
+
+    if (sths34pf80_func_cfg_close(ctx) != RT_EOK)
+    {
+        ret = -RT_ERROR;
+    }
+    return ret;
+}
+
+/**
+  * @brief  Program a complete configuration image with writes only: power down, filters,
+  * @brief  averaging, CTRL3 and the embedded threshold block and algorithm reset in one
+  * @brief  session, then start the ODR of the image. The shadow cache is refreshed from the image.
+*/
+int32_t sths34pf80_image_write(sths34pf80_ctx_t *ctx, const sths34pf80_image_t *img)
 {
     sths34pf80_reg_t reg;
+    uint8_t buf[2];
     int32_t ret;
-    uint8_t raw;
+    uint16_t i;
 
-    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+    /* embedded registers may only be written in power-down */
+    reg.byte = img->ctrl1;
+    reg.ctrl_reg1.odr = 0;
+    ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL1, &(reg.byte), 1);
     if (ret == RT_EOK)
     {
-        reg.ctrl_reg2.func_cfg_access = 1;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        buf[0] = img->lpf1;
+        buf[1] = img->lpf2;
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_LPF1, buf, 2);
     }
     if (ret == RT_EOK)
     {
-        reg.byte = 0x20;
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_AVG_TRIM, (uint8_t *)&(img->avg_trim), 1);
+    }
+    if (ret != RT_EOK)
+    {
+        sths34pf80_shadow_invalidate(ctx);
+        return ret;
+    }
+
+    /* CTRL2 opens the embedded page, CTRL3 rides along in the same transfer */
+    reg.byte = 0;
+    reg.ctrl_reg2.func_cfg_access = 1;
+    buf[0] = reg.byte;
+    buf[1] = img->ctrl3;
+    ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, buf, 2);
+    if (ret == RT_EOK)
+    {
+        reg.byte = STHS34PF80_FUNC_CFG_WRITE;
         ret = sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1);
     }
     if (ret == RT_EOK)
     {
-        reg.byte = addr;
-        ret = sths34pf80_write_reg(ctx,STHS34PF80_FUNC_CFG_ADDR , &(reg.byte), 1);
+        reg.byte = STHS34PF80_PRESENCE_THS_L;
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_ADDR, &(reg.byte), 1);
     }
+    for (i = 0; (ret == RT_EOK) && (i < sizeof(img->ths)); i++)
+    {
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_DATA, (uint8_t *)&(img->ths[i]), 1);
+    }
+    /* restart the algorithm on the new settings */
     if (ret == RT_EOK)
     {
-        ret = sths34pf80_read_reg(ctx, STHS34PF80_FUNC_CFG_DATA, &raw, 1);
+        reg.byte = STHS34PF80_RESET_ALGO;
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_ADDR, &(reg.byte), 1);
     }
     if (ret == RT_EOK)
     {
-        reg.byte = 0;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1);
+        reg.byte = 0x01;
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_FUNC_CFG_DATA, &(reg.byte), 1);
+    }
+
+    /* always leave the embedded page, even after a failed access */
+    reg.byte = 0;
+    if (sths34pf80_write_reg(ctx, STHS34PF80_PAGE_RW, &(reg.byte), 1) != RT_EOK ||
+        sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1) != RT_EOK)
+    {
+        ret = -RT_ERROR;
     }
     if (ret == RT_EOK)
     {
-        reg.ctrl_reg2.func_cfg_access = 0;
-        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL2, &(reg.byte), 1);
+        ret = sths34pf80_write_reg(ctx, STHS34PF80_CTRL1, (uint8_t *)&(img->ctrl1), 1);
+    }
+    if (ret != RT_EOK)
+    {
+        sths34pf80_shadow_invalidate(ctx);
+        return ret;
     }
 
-    *val = raw;
+    sths34pf80_shadow_store(ctx, STHS34PF80_LPF1, img->lpf1);
+    sths34pf80_shadow_store(ctx, STHS34PF80_LPF2, img->lpf2);
+    sths34pf80_shadow_store(ctx, STHS34PF80_AVG_TRIM, img->avg_trim);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL1, img->ctrl1);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL2, 0);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL3, img->ctrl3);
+    return RT_EOK;
+}
+
+/**
+  * @brief  Read back the configuration image: two bursts for the control registers, which
+  * @brief  also refresh the shadow cache, and an embedded session for the thresholds.
+  * @brief  ctrl2 receives CTRL2, who_am_i (if not NULL) WHO_AM_I from the first burst.
+  * @brief  While CTRL2 shows the embedded page left open the thresholds read as 0.
+*/
+int32_t sths34pf80_image_read(sths34pf80_ctx_t *ctx, sths34pf80_image_t *img, uint8_t *ctrl2, uint8_t *who_am_i)
+{
+    sths34pf80_reg_t reg;
+    uint8_t buf[5];
+    int32_t ret;
+    uint16_t i;
+
+    sths34pf80_shadow_invalidate(ctx);
 
+    /* LPF1, LPF2, reserved, WHO_AM_I, AVG_TRIM */
+    ret = sths34pf80_read_reg(ctx, STHS34PF80_LPF1, buf, 5);
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+    img->lpf1 = buf[0];
+    img->lpf2 = buf[1];
+    img->avg_trim = buf[4];
+    if (who_am_i != RT_NULL)
+    {
+        *who_am_i = buf[3];
+    }
+
+    /* CTRL1, CTRL2, CTRL3 */
+    ret = sths34pf80_read_reg(ctx, STHS34PF80_CTRL1, buf, 3);
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+    img->ctrl1 = buf[0];
+    img->ctrl3 = buf[2];
+    *ctrl2 = buf[1];
+
+    sths34pf80_shadow_store(ctx, STHS34PF80_LPF1, img->lpf1);
+    sths34pf80_shadow_store(ctx, STHS34PF80_LPF2, img->lpf2);
+    sths34pf80_shadow_store(ctx, STHS34PF80_AVG_TRIM, img->avg_trim);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL1, img->ctrl1);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL2, *ctrl2);
+    sths34pf80_shadow_store(ctx, STHS34PF80_CTRL3, img->ctrl3);
+
+    reg.byte = *ctrl2;
+    if (reg.ctrl_reg2.func_cfg_access)
+    {
+        for (i = 0; i < sizeof(img->ths); i++)
+        {
+            img->ths[i] = 0;
+        }
+        return RT_EOK;
+    }
+    return sths34pf80_func_cfg_read(ctx, STHS34PF80_PRESENCE_THS_L, img->ths, sizeof(img->ths));
+}
+
+/**
+  * @brief  Threshold for detection algorithms. This value is 15-bit unsigned
+*/
+int32_t sths34pf80_threshold_set(sths34pf80_ctx_t *ctx,uint8_t addr,uint8_t val)
+{
+    uint8_t odr;
+    uint8_t reset = 1;
+    int32_t ret;
+
+    /* embedded registers may only be written in power-down. There is no
+     * clock at this level to wait for DRDY, the conversion in progress is
+     * cut short; STHS34PF80_SetThresholds lets it finish. */
+    ret = sths34pf80_ctrl1_odr_get(ctx, &odr);
+    if (ret == RT_EOK && odr != 0)
+    {
+        ret = sths34pf80_ctrl1_odr_set(ctx, 0);
+    }
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    ret = sths34pf80_func_cfg_write(ctx, addr, &val, 1);
+    /* restart even if the session failed, from a reset algorithm */
+    if (odr != 0 &&
+        (sths34pf80_func_cfg_write(ctx, STHS34PF80_RESET_ALGO, &reset, 1) != RT_EOK ||
+         sths34pf80_ctrl1_odr_set(ctx, odr) != RT_EOK))
+    {
+        ret = -RT_ERROR;
+    }
     return ret;
 }
+
+int32_t sths34pf80_threshold_get(sths34pf80_ctx_t *ctx,uint8_t addr,uint8_t *val)
+{
+    return sths34pf80_func_cfg_read(ctx, addr, val, 1);
+}
@@ -15,6 +15,29 @@
 typedef int32_t (*sths34pf80_write_ptr)(void *, uint8_t, uint8_t *, uint16_t);
 typedef int32_t (*sths34pf80_read_ptr)(void *, uint8_t, uint8_t *, uint16_t);
 
+/* Write-through copy of the writable control registers */
+typedef struct
+{
+  uint8_t lpf1;
+  uint8_t lpf2;
+  uint8_t avg_trim;
+  uint8_t ctrl1;
+  uint8_t ctrl2;
+  uint8_t ctrl3;
+  uint8_t valid;    /* one bit per cached register, see sths34pf80_reg.c */
+} sths34pf80_shadow_t;
+
+/* Byte image of the whole writable configuration, see sths34pf80_image_write */
+typedef struct
+{
+  uint8_t lpf1;
+  uint8_t lpf2;
+  uint8_t avg_trim;
+  uint8_t ctrl1;
+  uint8_t ctrl3;
+  uint8_t ths[6];   /* embedded PRESENCE_THS_L .. TAMBSHOCK_THS_H */
+} sths34pf80_image_t;
+
 typedef struct
 {
   /** Component mandatory fields **/
@@ -22,6 +45,8 @@ typedef struct
   sths34pf80_read_ptr   read_reg;
   /** Customizable optional pointer **/
   void *handle;
+  /** Optional register cache, NULL to always go to the bus **/
+  sths34pf80_shadow_t *shadow;
 } sths34pf80_ctx_t;
 
 #define STHS34PF80_FUNC_CFG_ADDR   0X08
@@ -32,6 +57,11 @@ typedef struct
 #define STHS34PF80_MOTION_THS_H    0X23
 #define STHS34PF80_TAMBSHOCK_THS_L 0X24
 #define STHS34PF80_TAMBSHOCK_THS_H 0X25
+#define STHS34PF80_HYST_MOTION     0X26
+#define STHS34PF80_HYST_PRESENCE   0X27
+#define STHS34PF80_ALGO_CONFIG     0X28
+#define STHS34PF80_HYST_TAMB_SHOCK 0X29
+#define STHS34PF80_RESET_ALGO      0X2A
 #define STHS34PF80_PAGE_RW         0X11
 #define STHS34PF80_LPF1            0X0C
 #define STHS34PF80_LPF2            0X0D
@@ -54,6 +84,13 @@ typedef struct
 #define STHS34PF80_TAMB_SHOCK_L    0x3E
 #define STHS34PF80_TAMB_SHOCK_H    0x3F
 
+/* STATUS (23h) through TAMB_SHOCK_H (3Fh) read as one block */
+#define STHS34PF80_OUTPUT_BLOCK_LEN  (STHS34PF80_TAMB_SHOCK_H - STHS34PF80_STATUS + 1)
+
+/* PAGE_RW values selecting the embedded function access direction */
+#define STHS34PF80_FUNC_CFG_WRITE  0x40
+#define STHS34PF80_FUNC_CFG_READ   0x20
+
 typedef struct
 {
     uint8_t not_used1        : 5;
@@ -153,4 +190,67 @@ typedef union
     uint8_t                    byte;
 } sths34pf80_reg_t;
 
+int32_t sths34pf80_read_reg(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *data, uint16_t len);
+int32_t sths34pf80_write_reg(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *data, uint16_t len);
+
+void sths34pf80_shadow_invalidate(sths34pf80_ctx_t *ctx);
+int32_t sths34pf80_shadow_sync(sths34pf80_ctx_t *ctx);
+int32_t sths34pf80_shadow_get(sths34pf80_ctx_t *ctx, uint8_t reg, uint8_t *val);
+
+int32_t sths34pf80_lpf_presence_motion_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_lpf_presence_motion_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_lpf_motion_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_lpf_motion_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_lpf_presence_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_lpf_presence_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_lpf_temperature_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_lpf_temperature_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_who_am_i_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_avg_trim_avg_t_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_avg_trim_avg_t_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_avg_trim_avg_tmos_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_avg_trim_avg_tmos_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl1_bdu_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl1_bdu_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl1_odr_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl1_odr_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl2_boot_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl2_boot_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl2_func_cfg_access_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl2_func_cfg_access_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl2_one_shot_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl2_one_shot_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_int_h_l_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_int_h_l_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_int_msk0_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_int_msk0_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_int_msk1_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_int_msk1_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_int_msk2_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_int_msk2_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_pp_od_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_pp_od_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_ien_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_ctrl3_ien_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_ctrl3_set(sths34pf80_ctx_t *ctx, uint8_t val);
+int32_t sths34pf80_drdy_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_pres_flag_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_mot_flag_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_tamb_shock_flag_get(sths34pf80_ctx_t *ctx, uint8_t *val);
+int32_t sths34pf80_tobject_get(sths34pf80_ctx_t *ctx, uint16_t *val);
+int32_t sths34pf80_tambient_get(sths34pf80_ctx_t *ctx, uint16_t *val);
+int32_t sths34pf80_tpresence_get(sths34pf80_ctx_t *ctx, uint16_t *val);
+int32_t sths34pf80_tmotion_get(sths34pf80_ctx_t *ctx, uint16_t *val);
+int32_t sths34pf80_tamb_shock_get(sths34pf80_ctx_t *ctx, uint16_t *val);
+int32_t sths34pf80_object_ambient_get(sths34pf80_ctx_t *ctx, uint8_t *buf);
+int32_t sths34pf80_output_block_get(sths34pf80_ctx_t *ctx, uint8_t *buf);
+int32_t sths34pf80_func_cfg_open(sths34pf80_ctx_t *ctx, uint8_t mode, uint8_t addr);
+int32_t sths34pf80_func_cfg_close(sths34pf80_ctx_t *ctx);
+int32_t sths34pf80_func_cfg_write(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t *data, uint16_t len);
+int32_t sths34pf80_func_cfg_read(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t *data, uint16_t len);
+int32_t sths34pf80_image_write(sths34pf80_ctx_t *ctx, const sths34pf80_image_t *img);
+int32_t sths34pf80_image_read(sths34pf80_ctx_t *ctx, sths34pf80_image_t *img, uint8_t *ctrl2, uint8_t *who_am_i);
+int32_t sths34pf80_threshold_set(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t val);
+int32_t sths34pf80_threshold_get(sths34pf80_ctx_t *ctx, uint8_t addr, uint8_t *val);
+
 #endif /* APPLICATIONS_STHS34PF80_REG_H_ */
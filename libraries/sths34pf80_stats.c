@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <string.h>
+#include "sths34pf80_stats.h"
+
+static const char * const stats_names[STHS34PF80_STAT_NUM] =
+{
+    "bus_read",
+    "bus_write",
+    "init",
+    "read_id",
+    "read_presence",
+    "read_motion",
+    "read_temperature",
+    "read_frame",
+    "read_events",
+    "set_thresholds",
+    "control_int",
+    "set_odr",
+    "read_oneshot",
+    "read_object",
+};
+
+/**
+ * @brief  Clear every counter and histogram
+ * @param  stats the statistics block
+ */
+void STHS34PF80_StatsReset(STHS34PF80_Stats_t *stats)
+{
+  uint32_t i;
+
+  memset(stats, 0, sizeof(*stats));
+  for (i = 0; i < STHS34PF80_STAT_NUM; i++)
+  {
+    stats->Entry[i].Min = UINT32_MAX;
+  }
+}
+
+/**
+ * @brief  Account one call
+ * @param  stats the statistics block
+ * @param  id which call
+ * @param  ret the call result, non-zero counts as an error
+ * @param  elapsed latency in STHS34PF80_STATS_CLOCK units
+ */
+void STHS34PF80_StatsRecord(STHS34PF80_Stats_t *stats, STHS34PF80_StatId_t id, int32_t ret, uint32_t elapsed)
+{
+  STHS34PF80_StatEntry_t *entry = &stats->Entry[id];
+  uint32_t bucket = 0;
+
+  entry->Calls++;
+  if (ret != 0)
+  {
+    entry->Errors++;
+  }
+  if (elapsed < entry->Min)
+  {
+    entry->Min = elapsed;
+  }
+  if (elapsed > entry->Max)
+  {
+    entry->Max = elapsed;
+  }
+  entry->Sum += elapsed;
+
+  while (elapsed != 0 && bucket < STHS34PF80_STATS_BUCKETS - 1)
+  {
+    elapsed >>= 1;
+    bucket++;
+  }
+  entry->Hist[bucket]++;
+}
+
+/**
+ * @brief  Upper bound of the histogram bucket holding the given percentile
+ * @param  entry the call statistics
+ * @param  percent 1..100
+ * @retval latency bound, 0 if there were no calls
+ */
+uint32_t STHS34PF80_StatsPercentile(const STHS34PF80_StatEntry_t *entry, uint32_t percent)
+{
+  uint64_t target = ((uint64_t)entry->Calls * percent + 99) / 100;
+  uint64_t seen = 0;
+  uint32_t i;
+
+  if (entry->Calls == 0)
+  {
+    return 0;
+  }
+
+  for (i = 0; i < STHS34PF80_STATS_BUCKETS; i++)
+  {
+    seen += entry->Hist[i];
+    if (seen >= target)
+    {
+      break;
+    }
+  }
+
+  if (i == 0)
+  {
+    return 0;
+  }
+  if (i >= STHS34PF80_STATS_BUCKETS - 1)
+  {
+    return entry->Max;
+  }
+  /* never report more than was actually observed */
+  return ((1UL << i) - 1) < entry->Max ? ((1UL << i) - 1) : entry->Max;
+}
+
+const char *STHS34PF80_StatsName(STHS34PF80_StatId_t id)
+{
+  return id < STHS34PF80_STAT_NUM ? stats_names[id] : "?";
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_STATS_H_
+#define STHS34PF80_STATS_H_
+
+#include <stdint.h>
+
+/* Latency histogram: bucket 0 counts zero, bucket i counts [2^(i-1), 2^i),
+ * the last bucket is open-ended. Units are those of STHS34PF80_STATS_CLOCK. */
+#define STHS34PF80_STATS_BUCKETS    16
+
+typedef enum
+{
+    STHS34PF80_STAT_BUS_READ = 0,
+    STHS34PF80_STAT_BUS_WRITE,
+    STHS34PF80_STAT_INIT,
+    STHS34PF80_STAT_READ_ID,
+    STHS34PF80_STAT_READ_PRESENCE,
+    STHS34PF80_STAT_READ_MOTION,
+    STHS34PF80_STAT_READ_TEMPERATURE,
+    STHS34PF80_STAT_READ_FRAME,
+    STHS34PF80_STAT_READ_EVENTS,
+    STHS34PF80_STAT_SET_THRESHOLDS,
+    STHS34PF80_STAT_CONTROL_INT,
+    STHS34PF80_STAT_SET_ODR,
+    STHS34PF80_STAT_READ_ONESHOT,
+    STHS34PF80_STAT_READ_OBJECT,
+    STHS34PF80_STAT_NUM
+} STHS34PF80_StatId_t;
+
+typedef struct
+{
+    uint32_t    Calls;
+    uint32_t    Errors;
+    uint32_t    Min;
+    uint32_t    Max;
+    uint64_t    Sum;
+    uint32_t    Hist[STHS34PF80_STATS_BUCKETS];
+} STHS34PF80_StatEntry_t;
+
+typedef struct
+{
+    STHS34PF80_StatEntry_t  Entry[STHS34PF80_STAT_NUM];
+} STHS34PF80_Stats_t;
+
+void STHS34PF80_StatsReset(STHS34PF80_Stats_t *stats);
+void STHS34PF80_StatsRecord(STHS34PF80_Stats_t *stats, STHS34PF80_StatId_t id, int32_t ret, uint32_t elapsed);
+uint32_t STHS34PF80_StatsPercentile(const STHS34PF80_StatEntry_t *entry, uint32_t percent);
+const char *STHS34PF80_StatsName(STHS34PF80_StatId_t id);
+
+#endif /* STHS34PF80_STATS_H_ */
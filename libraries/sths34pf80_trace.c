@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_trace.h"
+
+static const uint8_t trace_magic[4] = { 'S', '3', '4', 'T' };
+
+static uint8_t *trace_put_u16(uint8_t *p, uint16_t val)
+{
+  p[0] = val & 0xFF;
+  p[1] = (val >> 8) & 0xFF;
+  return p + 2;
+}
+
+static uint8_t *trace_put_u32(uint8_t *p, uint32_t val)
+{
+  p = trace_put_u16(p, val & 0xFFFF);
+  return trace_put_u16(p, (val >> 16) & 0xFFFF);
+}
+
+static uint16_t trace_get_u16(const uint8_t *p)
+{
+  return (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static uint32_t trace_get_u32(const uint8_t *p)
+{
+  return (uint32_t)trace_get_u16(p + 2) << 16 | trace_get_u16(p);
+}
+
+static uint8_t *trace_put_varint(uint8_t *p, uint32_t val)
+{
+  while (val >= 0x80)
+  {
+    *p++ = (uint8_t)(val | 0x80);
+    val >>= 7;
+  }
+  *p++ = (uint8_t)val;
+  return p;
+}
+
+/* small differences of either sign map to small unsigned values */
+static uint8_t *trace_put_delta(uint8_t *p, int16_t val, int16_t prev)
+{
+  int32_t d = (int32_t)val - prev;
+
+  return trace_put_varint(p, d >= 0 ? (uint32_t)d << 1 : ((uint32_t)(-d) << 1) - 1);
+}
+
+static int32_t trace_get_varint(STHS34PF80_TraceReader_t *reader, uint32_t *val)
+{
+  uint32_t shift = 0;
+  uint8_t byte;
+
+  *val = 0;
+  do
+  {
+    if (reader->Pos >= reader->Len || shift > 28)
+    {
+      return STHS34PF80_ERROR;
+    }
+    byte = reader->Buf[reader->Pos++];
+    *val |= (uint32_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  return STHS34PF80_OK;
+}
+
+static int32_t trace_get_delta(STHS34PF80_TraceReader_t *reader, int16_t *val)
+{
+  uint32_t z;
+
+  if (trace_get_varint(reader, &z) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+  *val = (int16_t)(*val + ((z & 1) ? -(int32_t)((z + 1) >> 1) : (int32_t)(z >> 1)));
+
+  return STHS34PF80_OK;
+}
+
+static void trace_hook(void *arg, const STHS34PF80_Frame_t *frame)
+{
+  STHS34PF80_TraceRecorder_t *rec = (STHS34PF80_TraceRecorder_t *)arg;
+
+  STHS34PF80_TraceRecord(rec, rec->GetTick != NULL ? (uint32_t)rec->GetTick() : 0, frame);
+}
+
+/**
+ * @brief  Write the header and record every frame the object reads from now on
+ * @param  rec the recorder
+ * @param  pObj the device pObj, its Config goes into the header with LPF_P_M
+ *         and the hysteresis values, read from the sensor here
+ * @param  tick_hz GetTick units per second
+ * @param  write stores the encoded bytes, called from the frame reader's context
+ * @param  arg passed to write
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_TraceStart(STHS34PF80_TraceRecorder_t *rec, STHS34PF80_Object_t *pObj, uint32_t tick_hz,
+                              STHS34PF80_TraceWrite_Func write, void *arg)
+{
+  const STHS34PF80_Config_t *cfg = &(pObj->Config);
+  uint8_t buf[STHS34PF80_TRACE_HEADER_LEN];
+  uint8_t hyst[2];
+  uint8_t lpf_p_m;
+  uint8_t *p = buf;
+
+  if (sths34pf80_lpf_presence_motion_get(&(pObj->Ctx), &lpf_p_m) != STHS34PF80_OK ||
+      sths34pf80_func_cfg_read(&(pObj->Ctx), STHS34PF80_HYST_MOTION, hyst, sizeof(hyst)) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  memset(rec, 0, sizeof(*rec));
+  rec->Write = write;
+  rec->Arg = arg;
+  rec->GetTick = pObj->IO.GetTick;
+  rec->Last = rec->GetTick != NULL ? (uint32_t)rec->GetTick() : 0;
+
+  memcpy(p, trace_magic, sizeof(trace_magic));
+  p += sizeof(trace_magic);
+  *p++ = STHS34PF80_TRACE_VERSION;
+  *p++ = cfg->LPF_Motion;
+  *p++ = cfg->LPF_Presence;
+  *p++ = cfg->LPF_Temperature;
+  *p++ = cfg->AVG_TMOS;
+  *p++ = cfg->ODR;
+  p = trace_put_u16(p, cfg->THS_Motion);
+  p = trace_put_u16(p, cfg->THS_Presence);
+  p = trace_put_u16(p, cfg->THS_Temp_Shock);
+  *p++ = lpf_p_m;
+  *p++ = hyst[0];
+  *p++ = hyst[1];
+  p = trace_put_u32(p, tick_hz);
+  p = trace_put_u32(p, rec->Last);
+
+  if (rec->Write(rec->Arg, buf, (uint32_t)(p - buf)) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  STHS34PF80_SetFrameHook(pObj, trace_hook, rec);
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Stop recording the frames of an object
+ */
+void STHS34PF80_TraceStop(STHS34PF80_TraceRecorder_t *rec, STHS34PF80_Object_t *pObj)
+{
+  if (pObj->FrameHookArg == rec)
+  {
+    STHS34PF80_SetFrameHook(pObj, NULL, NULL);
+  }
+}
+
+/**
+ * @brief  Append one frame, for frames that do not come through the object
+ * @param  rec a started recorder
+ * @param  timestamp in the header tick units
+ * @param  frame the frame
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_TraceRecord(STHS34PF80_TraceRecorder_t *rec, uint32_t timestamp, const STHS34PF80_Frame_t *frame)
+{
+  uint8_t buf[STHS34PF80_TRACE_RECORD_MAX];
+  uint8_t *p = buf;
+
+  p = trace_put_varint(p, timestamp - rec->Last);
+  *p++ = frame->FuncStatus;
+  p = trace_put_delta(p, frame->TObject, rec->Prev.TObject);
+  p = trace_put_delta(p, frame->TAmbient, rec->Prev.TAmbient);
+  p = trace_put_delta(p, frame->TPresence, rec->Prev.TPresence);
+  p = trace_put_delta(p, frame->TMotion, rec->Prev.TMotion);
+  p = trace_put_delta(p, frame->TAmbShock, rec->Prev.TAmbShock);
+
+  if (rec->Write(rec->Arg, buf, (uint32_t)(p - buf)) != STHS34PF80_OK)
+  {
+    /* keep the deltas chained to what was stored */
+    rec->Errors++;
+    return STHS34PF80_ERROR;
+  }
+
+  rec->Last = timestamp;
+  rec->Prev = *frame;
+  rec->Frames++;
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Check the header of a trace held in memory
+ * @param  reader the reader, Header is filled
+ * @param  buf the whole trace
+ * @param  len its length
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t STHS34PF80_TraceOpen(STHS34PF80_TraceReader_t *reader, const uint8_t *buf, uint32_t len)
+{
+  STHS34PF80_Config_t *cfg = &(reader->Header.Config);
+  const uint8_t *p = buf + sizeof(trace_magic);
+
+  memset(reader, 0, sizeof(*reader));
+  if (len < STHS34PF80_TRACE_HEADER_LEN || memcmp(buf, trace_magic, sizeof(trace_magic)) != 0 ||
+      *p++ != STHS34PF80_TRACE_VERSION)
+  {
+    return STHS34PF80_ERROR;
+  }
+
+  cfg->LPF_Motion = *p++;
+  cfg->LPF_Presence = *p++;
+  cfg->LPF_Temperature = *p++;
+  cfg->AVG_TMOS = *p++;
+  cfg->ODR = *p++;
+  cfg->THS_Motion = trace_get_u16(p);
+  cfg->THS_Presence = trace_get_u16(p + 2);
+  cfg->THS_Temp_Shock = trace_get_u16(p + 4);
+  reader->Header.LPF_P_M = p[6];
+  reader->Header.HYST_Motion = p[7];
+  reader->Header.HYST_Presence = p[8];
+  reader->Header.TickHz = trace_get_u32(p + 9);
+  reader->Header.Start = trace_get_u32(p + 13);
+
+  reader->Buf = buf;
+  reader->Len = len;
+  reader->Pos = STHS34PF80_TRACE_HEADER_LEN;
+  reader->Time = reader->Header.Start;
+
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Decode the next record
+ * @param  reader an opened reader
+ * @param  timestamp the record time in header tick units
+ * @param  frame the recorded frame, Drdy set
+ * @retval 0 in case of success, an error code at the end or on a truncated record
+ */
+int32_t STHS34PF80_TraceNext(STHS34PF80_TraceReader_t *reader, uint32_t *timestamp, STHS34PF80_Frame_t *frame)
+{
+  STHS34PF80_Frame_t next = reader->Prev;
+  uint32_t dt;
+
+  if (trace_get_varint(reader, &dt) != STHS34PF80_OK || reader->Pos >= reader->Len)
+  {
+    return STHS34PF80_ERROR;
+  }
+  next.FuncStatus = reader->Buf[reader->Pos++];
+  if (trace_get_delta(reader, &next.TObject) != STHS34PF80_OK ||
+      trace_get_delta(reader, &next.TAmbient) != STHS34PF80_OK ||
+      trace_get_delta(reader, &next.TPresence) != STHS34PF80_OK ||
+      trace_get_delta(reader, &next.TMotion) != STHS34PF80_OK ||
+      trace_get_delta(reader, &next.TAmbShock) != STHS34PF80_OK)
+  {
+    return STHS34PF80_ERROR;
+  }
+  next.Drdy = 1;
+
+  reader->Time += dt;
+  reader->Prev = next;
+  *timestamp = reader->Time;
+  *frame = next;
+
+  return STHS34PF80_OK;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_TRACE_H_
+#define STHS34PF80_TRACE_H_
+
+#include "sths34pf80.h"
+
+/* Binary capture of the raw output stream, little-endian:
+ *
+ *   header  "S34T", version, LPF_Motion, LPF_Presence, LPF_Temperature,
+ *           AVG_TMOS, ODR, THS_Motion, THS_Presence, THS_Temp_Shock (u16),
+ *           LPF_P_M, HYST_Motion, HYST_Presence (u8, read from the sensor),
+ *           tick rate in Hz (u32), timestamp of the start (u32)
+ *   record  ticks since the previous record (varint), FUNC_STATUS (u8),
+ *           then TOBJECT, TAMBIENT, TPRESENCE, TMOTION and TAMB_SHOCK as
+ *           zigzag varint differences to the previous record
+ *
+ * A quiet sensor costs 7 bytes per frame. */
+
+#define STHS34PF80_TRACE_VERSION        2U
+#define STHS34PF80_TRACE_HEADER_LEN     27U
+#define STHS34PF80_TRACE_RECORD_MAX     21U     /* 5 + 1 + 5 * 3 */
+
+/* Store len bytes, return STHS34PF80_OK or an error code */
+typedef int32_t (*STHS34PF80_TraceWrite_Func)(void *arg, const uint8_t *data, uint32_t len);
+
+typedef struct
+{
+    STHS34PF80_Config_t     Config;
+    uint8_t                 LPF_P_M;        /* not part of Config, the algorithm needs them */
+    uint8_t                 HYST_Motion;
+    uint8_t                 HYST_Presence;
+    uint32_t                TickHz;
+    uint32_t                Start;
+} STHS34PF80_TraceHeader_t;
+
+typedef struct
+{
+    STHS34PF80_TraceWrite_Func  Write;
+    void                       *Arg;
+    STHS34PF80_GetTick_Func     GetTick;
+    uint32_t                    Last;       /* timestamp of the previous record */
+    STHS34PF80_Frame_t          Prev;
+    uint32_t                    Frames;
+    uint32_t                    Errors;     /* records Write refused */
+} STHS34PF80_TraceRecorder_t;
+
+typedef struct
+{
+    const uint8_t              *Buf;
+    uint32_t                    Len;
+    uint32_t                    Pos;
+    uint32_t                    Time;
+    STHS34PF80_Frame_t          Prev;
+    STHS34PF80_TraceHeader_t    Header;
+} STHS34PF80_TraceReader_t;
+
+int32_t STHS34PF80_TraceStart(STHS34PF80_TraceRecorder_t *rec, STHS34PF80_Object_t *pObj, uint32_t tick_hz,
+                              STHS34PF80_TraceWrite_Func write, void *arg);
+void STHS34PF80_TraceStop(STHS34PF80_TraceRecorder_t *rec, STHS34PF80_Object_t *pObj);
+int32_t STHS34PF80_TraceRecord(STHS34PF80_TraceRecorder_t *rec, uint32_t timestamp, const STHS34PF80_Frame_t *frame);
+int32_t STHS34PF80_TraceOpen(STHS34PF80_TraceReader_t *reader, const uint8_t *buf, uint32_t len);
+int32_t STHS34PF80_TraceNext(STHS34PF80_TraceReader_t *reader, uint32_t *timestamp, STHS34PF80_Frame_t *frame);
+
+#endif /* STHS34PF80_TRACE_H_ */
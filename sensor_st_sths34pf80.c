@@ -7,14 +7,148 @@
  * Date           Author       Notes
  * 2023-01-29     Rick       the first version
  */
+#include <stdlib.h>
 #include "sensor_st_sths34pf80.h"
 
 #define DBG_TAG "sensor.st.sths34pf80"
 #define DBG_LVL DBG_LOG
 
 
-static STHS34PF80_Object_t sths34pf80;
-static struct rt_i2c_bus_device *i2c_bus_dev;
+#ifndef PKG_STHS34PF80_FIFO_WATERMARK
+#define PKG_STHS34PF80_FIFO_WATERMARK           (STHS34PF80_FIFO_DEPTH / 2)
+#endif
+#ifndef PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE
+#define PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE    1024
+#endif
+#ifndef PKG_STHS34PF80_IRQ_THREAD_PRIORITY
+#define PKG_STHS34PF80_IRQ_THREAD_PRIORITY      10
+#endif
+#ifndef PKG_STHS34PF80_BUS_THREAD_STACK_SIZE
+#define PKG_STHS34PF80_BUS_THREAD_STACK_SIZE    1024
+#endif
+#ifndef PKG_STHS34PF80_BUS_THREAD_PRIORITY
+#define PKG_STHS34PF80_BUS_THREAD_PRIORITY      9       /* above the irq threads it serves */
+#endif
+#ifndef PKG_STHS34PF80_ONESHOT_TIMEOUT_MS
+#define PKG_STHS34PF80_ONESHOT_TIMEOUT_MS       200
+#endif
+#ifndef PKG_STHS34PF80_PROFILE
+#define PKG_STHS34PF80_PROFILE                  STHS34PF80_PROFILE_DEFAULT
+#endif
+#ifndef PKG_STHS34PF80_WARM_START_REBOOT
+#define PKG_STHS34PF80_WARM_START_REBOOT        0       /* 1: CTRL2.BOOT before any reprogramming */
+#endif
+#ifndef PKG_STHS34PF80_GOV_QUIET_MS
+#define PKG_STHS34PF80_GOV_QUIET_MS             30000   /* back to the idle ODR after this long without activity */
+#endif
+#ifndef PKG_STHS34PF80_CALIB_SAMPLES
+#define PKG_STHS34PF80_CALIB_SAMPLES            150     /* 10 s at the default 15 Hz */
+#endif
+#ifndef PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS
+#define PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS     20      /* on top of one frame when stopping conversions */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_COUNT
+#define PKG_STHS34PF80_RETRY_COUNT              2       /* retries of a failed transfer */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_BACKOFF_MS
+#define PKG_STHS34PF80_RETRY_BACKOFF_MS         1       /* before the first retry, doubled for each next one */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_BUDGET_MS
+#define PKG_STHS34PF80_RETRY_BUDGET_MS          20      /* give up on a transfer failing for this long */
+#endif
+#ifndef PKG_STHS34PF80_RESYNC_RETRY_MS
+#define PKG_STHS34PF80_RESYNC_RETRY_MS          1000    /* irq thread, while a resync keeps failing */
+#endif
+#ifndef PKG_STHS34PF80_CALIB_TIMEOUT_MS
+#define PKG_STHS34PF80_CALIB_TIMEOUT_MS         4500    /* one frame at the slowest ODR */
+#endif
+
+/* sensor channels, in registration order */
+enum
+{
+    STHS34PF80_CHANNEL_PRESENCE = 0,
+    STHS34PF80_CHANNEL_TEMP,
+    STHS34PF80_CHANNEL_MOTION,
+    STHS34PF80_CHANNEL_TOBJECT,     /* in module.sen only when RT_SENSOR_MODULE_MAX allows 4 */
+    STHS34PF80_CHANNEL_NUM
+};
+
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+/* one per I2C controller, serialises the transfers of every sensor on it */
+struct sths34pf80_bus
+{
+    rt_list_t                   node;       /* entry in sths34pf80_buses */
+    struct rt_i2c_bus_device   *i2c;
+    char                        name[RT_NAME_MAX];
+    rt_uint32_t                 ref;        /* sensors using it */
+    struct rt_mutex             lock;       /* guards queue */
+    struct rt_semaphore         wake;       /* released once per queued request */
+    rt_thread_t                 thread;
+    STHS34PF80_BusQueue_t       queue;
+};
+#endif
+
+struct sths34pf80_device
+{
+    struct rt_sensor_module     module;     /* shared by the channels of one sensor */
+    rt_sensor_t                 channel[STHS34PF80_CHANNEL_NUM];
+    STHS34PF80_Object_t         obj;
+    struct rt_i2c_bus_device   *bus;
+    char                        name[RT_NAME_MAX];
+    rt_list_t                   node;       /* entry in sths34pf80_devices */
+    struct rt_mutex             lock;       /* guards obj: irq thread, control and msh */
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+    struct sths34pf80_bus      *sched;      /* queue in front of bus */
+#endif
+
+    /* interrupt acquisition */
+    rt_base_t                   irq_pin;
+    rt_uint8_t                  irq_enabled;
+    struct rt_semaphore         irq_sem;
+    rt_thread_t                 irq_thread;
+    volatile rt_uint32_t        irq_ts;     /* taken in the ISR, closest to the event */
+
+    /* on-demand acquisition: power-down between one-shot conversions */
+    rt_uint8_t                  oneshot;
+    volatile rt_uint8_t         oneshot_wait;   /* divert the next INT edge to oneshot_sem */
+    struct rt_semaphore         oneshot_sem;
+
+    /* one SPSC ring per channel: irq thread produces, channel reader consumes */
+    STHS34PF80_Fifo_t           fifo[STHS34PF80_CHANNEL_NUM];
+
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    /* adaptive ODR, fed by the irq thread with every frame */
+    rt_uint8_t                  governed;
+    STHS34PF80_Gov_t            gov;
+#endif
+};
+
+/* the governor takes every DRDY in the irq thread, like a streaming channel */
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+#define STHS34PF80_GOVERNED(dev)    ((dev)->governed)
+#else
+#define STHS34PF80_GOVERNED(dev)    0
+#endif
+
+#define STHS34PF80_DEVICE(sensor)   rt_container_of((sensor)->module, struct sths34pf80_device, module)
+
+/* every successfully initialised sensor, for the msh command */
+static rt_list_t sths34pf80_devices = RT_LIST_OBJECT_INIT(sths34pf80_devices);
+
+static rt_uint8_t _sths34pf80_channel(rt_sensor_t sensor)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    rt_uint8_t i;
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (dev->channel[i] == sensor)
+        {
+            break;
+        }
+    }
+    return i;
+}
 
 static int32_t i2c_init(void)
 {
@@ -26,7 +160,12 @@ static int32_t sths34pf80_get_tick(void)
     return rt_tick_get();
 }
 
-static int rt_i2c_write_reg(uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+static void sths34pf80_delay(uint32_t ticks)
+{
+    rt_thread_delay(ticks);
+}
+
+static int rt_i2c_write_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
 {
     rt_uint8_t tmp = reg;
     struct rt_i2c_msg msgs[2];
@@ -41,7 +180,7 @@ static int rt_i2c_write_reg(uint16_t addr, uint16_t reg, uint8_t *data, uint16_t
     msgs[1].buf   = data;             /* Read data pointer */
     msgs[1].len   = len;              /* Number of bytes read */
 
-    if (rt_i2c_transfer(i2c_bus_dev, msgs, 2) != 2)
+    if (rt_i2c_transfer((struct rt_i2c_bus_device *)bus, msgs, 2) != 2)
     {
         return -RT_ERROR;
     }
@@ -49,7 +188,7 @@ static int rt_i2c_write_reg(uint16_t addr, uint16_t reg, uint8_t *data, uint16_t
     return RT_EOK;
 }
 
-static int rt_i2c_read_reg(uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+static int rt_i2c_read_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
 {
     rt_uint8_t tmp = reg;
     struct rt_i2c_msg msgs[2];
@@ -64,84 +203,476 @@ static int rt_i2c_read_reg(uint16_t addr, uint16_t reg, uint8_t *data, uint16_t
     msgs[1].buf   = data;             /* Read data pointer */
     msgs[1].len   = len;              /* Number of bytes read */
 
-    if (rt_i2c_transfer(i2c_bus_dev, msgs, 2) != 2)
+    if (rt_i2c_transfer((struct rt_i2c_bus_device *)bus, msgs, 2) != 2)
     {
         return -RT_ERROR;
     }
 
     return RT_EOK;
 }
-static rt_err_t _sths34pf80_init(struct rt_sensor_intf *intf)
+
+/* Frees a stuck bus before a transfer is retried: SDA held low by a slave
+ * reset in the middle of a byte, or SCL stretched past the controller
+ * timeout. Boards override it to clock out SCL pulses and a STOP, or to
+ * reset the controller; it runs with the bus locked. */
+RT_WEAK rt_err_t sths34pf80_bus_recover(struct rt_i2c_bus_device *bus)
+{
+    (void)bus;
+    return -RT_ENOSYS;
+}
+
+static int32_t rt_i2c_recover(void *bus)
+{
+    struct rt_i2c_bus_device *i2c = (struct rt_i2c_bus_device *)bus;
+    rt_err_t ret;
+
+    rt_mutex_take(&i2c->lock, RT_WAITING_FOREVER);
+    ret = sths34pf80_bus_recover(i2c);
+    rt_mutex_release(&i2c->lock);
+
+    return ret == RT_EOK ? STHS34PF80_OK : STHS34PF80_ERROR;
+}
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+static rt_list_t sths34pf80_buses = RT_LIST_OBJECT_INIT(sths34pf80_buses);
+
+static void sths34pf80_bus_thread_entry(void *parameter)
+{
+    struct sths34pf80_bus *bus = (struct sths34pf80_bus *)parameter;
+    STHS34PF80_BusReq_t *batch[STHS34PF80_BUS_BATCH_MAX];
+    struct rt_i2c_msg msgs[2 * STHS34PF80_BUS_BATCH_MAX];
+    rt_uint8_t regs[STHS34PF80_BUS_BATCH_MAX];
+    rt_uint32_t n, i;
+    rt_int32_t ret;
+
+    while (1)
+    {
+        rt_sem_take(&bus->wake, RT_WAITING_FOREVER);
+
+        rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+        n = STHS34PF80_BusTake(&bus->queue, batch, STHS34PF80_BUS_BATCH_MAX);
+        rt_mutex_release(&bus->lock);
+
+        for (i = 0; i < n; i++)
+        {
+            regs[i] = batch[i]->Reg;
+            msgs[2 * i].addr      = batch[i]->Addr;
+            msgs[2 * i].flags     = RT_I2C_WR;
+            msgs[2 * i].buf       = &regs[i];
+            msgs[2 * i].len       = 1;
+            msgs[2 * i + 1].addr  = batch[i]->Addr;
+            msgs[2 * i + 1].flags = batch[i]->Read ? RT_I2C_RD : RT_I2C_WR | RT_I2C_NO_START;
+            msgs[2 * i + 1].buf   = batch[i]->Data;
+            msgs[2 * i + 1].len   = batch[i]->Len;
+        }
+
+        /* back to back under one hold of the controller lock (an RT-Thread
+         * mutex nests, rt_i2c_transfer takes it again), one transfer per
+         * request: a NACK fails only the request it hit, the frame reads of
+         * the other sensors in the batch complete with their flags. Nothing
+         * is issued twice here, each submitter's retry policy decides what is
+         * safe to repeat */
+        rt_mutex_take(&bus->i2c->lock, RT_WAITING_FOREVER);
+        for (i = 0; i < n; i++)
+        {
+            ret = (rt_int32_t)rt_i2c_transfer(bus->i2c, &msgs[2 * i], 2);
+            STHS34PF80_BusDone(&bus->queue, batch[i], ret == 2 ? STHS34PF80_OK : STHS34PF80_ERROR);
+        }
+        rt_mutex_release(&bus->i2c->lock);
+
+        for (i = 0; i < n; i++)
+        {
+            rt_completion_done((struct rt_completion *)batch[i]->Arg);
+        }
+    }
+}
+
+static int _sths34pf80_bus_xfer(struct sths34pf80_bus *bus, uint16_t addr, uint16_t reg, uint8_t *data,
+                                uint16_t len, rt_uint8_t read)
 {
+    STHS34PF80_BusReq_t req;
+    struct rt_completion done;
+
+    rt_completion_init(&done);
+    STHS34PF80_BusReqInit(&req, addr, (uint8_t)reg, data, len, read, &done);
+
+    rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+    STHS34PF80_BusPush(&bus->queue, &req);
+    rt_mutex_release(&bus->lock);
+    rt_sem_release(&bus->wake);
+
+    rt_completion_wait(&done, RT_WAITING_FOREVER);
+    return req.Result == STHS34PF80_OK ? RT_EOK : -RT_ERROR;
+}
+
+static int rt_i2c_queue_write_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+    return _sths34pf80_bus_xfer((struct sths34pf80_bus *)bus, addr, reg, data, len, 0);
+}
+
+static int rt_i2c_queue_read_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+    return _sths34pf80_bus_xfer((struct sths34pf80_bus *)bus, addr, reg, data, len, 1);
+}
+
+static int32_t rt_i2c_queue_recover(void *bus)
+{
+    return rt_i2c_recover(((struct sths34pf80_bus *)bus)->i2c);
+}
+
+/* the queue of an I2C controller, created with its first sensor */
+static struct sths34pf80_bus *_sths34pf80_bus_get(struct rt_i2c_bus_device *i2c, const char *name)
+{
+    struct sths34pf80_bus *bus;
+
+    rt_list_for_each_entry(bus, &sths34pf80_buses, node)
+    {
+        if (bus->i2c == i2c)
+        {
+            bus->ref++;
+            return bus;
+        }
+    }
+
+    bus = rt_calloc(1, sizeof(struct sths34pf80_bus));
+    if (bus == RT_NULL)
+    {
+        return RT_NULL;
+    }
+    bus->i2c = i2c;
+    bus->ref = 1;
+    rt_strncpy(bus->name, name, RT_NAME_MAX);
+    STHS34PF80_BusInit(&bus->queue);
+    rt_mutex_init(&bus->lock, "sths_bq", RT_IPC_FLAG_PRIO);
+    rt_sem_init(&bus->wake, "sths_bq", 0, RT_IPC_FLAG_FIFO);
+    bus->thread = rt_thread_create("sths_bq", sths34pf80_bus_thread_entry, bus,
+                                   PKG_STHS34PF80_BUS_THREAD_STACK_SIZE,
+                                   PKG_STHS34PF80_BUS_THREAD_PRIORITY, 10);
+    if (bus->thread == RT_NULL)
+    {
+        rt_sem_detach(&bus->wake);
+        rt_mutex_detach(&bus->lock);
+        rt_free(bus);
+        return RT_NULL;
+    }
+    rt_list_insert_before(&sths34pf80_buses, &bus->node);
+    rt_thread_startup(bus->thread);
+    return bus;
+}
+
+static void _sths34pf80_bus_put(struct sths34pf80_bus *bus)
+{
+    if (bus == RT_NULL || --bus->ref > 0)
+    {
+        return;
+    }
+    /* no sensor left to queue anything, the thread is idle on wake */
+    rt_thread_delete(bus->thread);
+    rt_list_remove(&bus->node);
+    rt_sem_detach(&bus->wake);
+    rt_mutex_detach(&bus->lock);
+    rt_free(bus);
+}
+#endif /* PKG_STHS34PF80_USING_BUS_QUEUE */
+
+static rt_err_t _sths34pf80_init(struct sths34pf80_device *dev, struct rt_sensor_intf *intf)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
     STHS34PF80_IO_t io_ctx;
+#ifdef PKG_STHS34PF80_USING_WARM_START
+    STHS34PF80_WarmResult_t warm;
+#else
     rt_uint8_t        id;
+#endif
 
-    i2c_bus_dev = (struct rt_i2c_bus_device *)rt_device_find(intf->dev_name);
-    if (i2c_bus_dev == RT_NULL)
+    dev->bus = (struct rt_i2c_bus_device *)rt_device_find(intf->dev_name);
+    if (dev->bus == RT_NULL)
     {
         return -RT_ERROR;
     }
 
     /* Configure the baroelero driver */
-    io_ctx.BusType     = STHS34PF80_I2C_BUS; /* I2C */
+    if ((rt_uint32_t)(intf->user_data) & STHS34PF80_INTF_SINGLE_BYTE)
+    {
+        io_ctx.BusType = STHS34PF80_I2C_BUS;       /* I2C, one register per transfer */
+    }
+    else
+    {
+        io_ctx.BusType = STHS34PF80_I2C_BURST_BUS; /* I2C, auto-increment burst */
+    }
     io_ctx.Address     = (rt_uint32_t)(intf->user_data) & 0xff;
     io_ctx.Init        = i2c_init;
     io_ctx.DeInit      = i2c_init;
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+    /* every sensor on this controller goes through one queue */
+    dev->sched = _sths34pf80_bus_get(dev->bus, intf->dev_name);
+    if (dev->sched == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    io_ctx.Handle      = dev->sched;
+    io_ctx.ReadReg     = rt_i2c_queue_read_reg;
+    io_ctx.WriteReg    = rt_i2c_queue_write_reg;
+    io_ctx.Recover     = rt_i2c_queue_recover;
+#else
+    io_ctx.Handle      = dev->bus;
     io_ctx.ReadReg     = rt_i2c_read_reg;
     io_ctx.WriteReg    = rt_i2c_write_reg;
+    io_ctx.Recover     = rt_i2c_recover;
+#endif
     io_ctx.GetTick     = sths34pf80_get_tick;
+    io_ctx.Delay       = sths34pf80_delay;
 
-    sths34pf80.Config.LPF_Motion = 0x04;
-    sths34pf80.Config.LPF_Presence = 0x04;
-    sths34pf80.Config.LPF_Temperature = 0x02;
-    sths34pf80.Config.AVG_TMOS = 0x02;
-    sths34pf80.Config.ODR = 0x07;
-    sths34pf80.Config.THS_Presence = 5000;
-    sths34pf80.Config.THS_Motion = 2300;
-    sths34pf80.Config.THS_Temp_Shock = 2000;
-
-    if (STHS34PF80_RegisterBusIO(&sths34pf80, &io_ctx) != STHS34PF80_OK)
+    if (STHS34PF80_RegisterBusIO(sths34pf80, &io_ctx) != STHS34PF80_OK)
     {
         return -RT_ERROR;
     }
-    else if (STHS34PF80_ReadID(&sths34pf80, &id) != STHS34PF80_OK)
+    STHS34PF80_SetRetryPolicy(sths34pf80, PKG_STHS34PF80_RETRY_COUNT,
+                              rt_tick_from_millisecond(PKG_STHS34PF80_RETRY_BACKOFF_MS),
+                              rt_tick_from_millisecond(PKG_STHS34PF80_RETRY_BUDGET_MS));
+#ifdef PKG_STHS34PF80_USING_WARM_START
+    /* the sensor may have kept its power and configuration across our reset */
+    if (STHS34PF80_WarmStart(sths34pf80, &STHS34PF80_ProfileGet(PKG_STHS34PF80_PROFILE)->Image,
+                             PKG_STHS34PF80_WARM_START_REBOOT, &warm) != STHS34PF80_OK)
+    {
+        rt_kprintf("sths34pf80 warm start failed\n");
+        return -RT_ERROR;
+    }
+    LOG_I("warm start: %s", warm == STHS34PF80_WARM_VERIFIED ? "configuration kept" :
+                            warm == STHS34PF80_WARM_CTRL3 ? "CTRL3 rewritten" :
+                            warm == STHS34PF80_WARM_REPROGRAMMED ? "reprogrammed" : "rebooted");
+#else
+    if (STHS34PF80_ReadID(sths34pf80, &id) != STHS34PF80_OK)
     {
         rt_kprintf("read id failed\n");
         return -RT_ERROR;
     }
-    if (STHS34PF80_Init(&sths34pf80) != STHS34PF80_OK)
+    /* one precomputed register image, written without reads */
+    if (STHS34PF80_ApplyProfile(sths34pf80, PKG_STHS34PF80_PROFILE) != STHS34PF80_OK)
     {
         rt_kprintf("sths34pf80 init failed\n");
         return -RT_ERROR;
     }
+#endif
 
     return RT_EOK;
 }
+/* wait for the conversion in progress before powering down */
+static rt_int32_t _sths34pf80_switch_timeout(STHS34PF80_Object_t *sths34pf80)
+{
+    uint8_t odr;
+
+    if (sths34pf80_ctrl1_odr_get(&sths34pf80->Ctx, &odr) != STHS34PF80_OK)
+    {
+        odr = sths34pf80->Config.ODR;
+    }
+    return rt_tick_from_millisecond(STHS34PF80_ODRPeriodMs(odr) + PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS);
+}
+/* a transfer failed: put back the configuration the registers should hold */
+static void _sths34pf80_resync(struct sths34pf80_device *dev)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_WarmResult_t result;
+    uint8_t power = sths34pf80->Power;
+    int32_t ret;
+
+    if (!sths34pf80->ResyncPending)
+    {
+        return;
+    }
+    /* Power is the mode to resume in, between one-shots the sensor is down */
+    if (dev->oneshot)
+    {
+        sths34pf80->Power = STHS34PF80_POWER_DOWN;
+    }
+    ret = STHS34PF80_Resync(sths34pf80, &result);
+    sths34pf80->Power = power;
+
+    if (ret != STHS34PF80_OK)
+    {
+        LOG_W("%s: resync failed, %u transfers given up", dev->name, sths34pf80->Faults.Failed);
+    }
+    else if (result != STHS34PF80_WARM_VERIFIED)
+    {
+        LOG_W("%s: configuration restored after a bus fault (%s)", dev->name,
+              result == STHS34PF80_WARM_CTRL3 ? "CTRL3 rewritten" :
+              result == STHS34PF80_WARM_REPROGRAMMED ? "reprogrammed" : "rebooted");
+    }
+}
+/* odr in Hz, rounded up to the next rate the sensor has */
 static rt_err_t _sths34pf80_set_odr(rt_sensor_t sensor, rt_uint16_t odr)
 {
-    sths34pf80_ctrl1_odr_set(&sths34pf80.Ctx, odr);
+    /* whole Hz of each ODR code, 0.25 and 0.5 Hz round down */
+    static const rt_uint8_t odr_hz[9] = { 0, 0, 0, 1, 2, 4, 8, 15, 30 };
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    uint8_t code, i;
+    int32_t ret = STHS34PF80_OK;
+
+    for (code = 1; code < STHS34PF80_MaxODR(sths34pf80->Config.AVG_TMOS); code++)
+    {
+        if (odr_hz[code] >= odr)
+        {
+            break;
+        }
+    }
+
+    if (dev->oneshot)
+    {
+        /* taken up when continuous conversions resume */
+        sths34pf80->Config.ODR = code;
+    }
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    else if (dev->governed)
+    {
+        /* the rate used while there is activity */
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_SET_ODR, ret,
+                              STHS34PF80_GovSetActiveODR(&dev->gov, sths34pf80, code,
+                                                         _sths34pf80_switch_timeout(sths34pf80)));
+    }
+#endif
+    else
+    {
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_SET_ODR, ret,
+                              STHS34PF80_SetODR(sths34pf80, code, _sths34pf80_switch_timeout(sths34pf80)));
+    }
+    if (ret != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+
+    /* one sensor behind every channel, the module only lists some of them */
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        dev->channel[i]->config.odr = odr;
+    }
+    return RT_EOK;
+}
+/* the channels share one sensor: it runs in the most active mode any of them asks for */
+static rt_err_t _sths34pf80_set_power(rt_sensor_t sensor, rt_uint8_t power)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_Power_t mode = STHS34PF80_POWER_DOWN;
+    rt_bool_t requested = RT_FALSE;
+    rt_uint8_t request;
+    rt_uint8_t i;
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        request = dev->channel[i] == sensor ? power : dev->channel[i]->config.power;
+        switch (request)
+        {
+        case RT_SENSOR_POWER_NORMAL:
+        case RT_SENSOR_POWER_HIGH:
+            mode = STHS34PF80_POWER_NORMAL;
+            requested = RT_TRUE;
+            break;
+        case RT_SENSOR_POWER_LOW:
+            mode = mode == STHS34PF80_POWER_NORMAL ? mode : STHS34PF80_POWER_LOW;
+            requested = RT_TRUE;
+            break;
+        case RT_SENSOR_POWER_DOWN:
+            requested = RT_TRUE;
+            break;
+        default:
+            /* RT_SENSOR_POWER_NONE: no request from this channel */
+            break;
+        }
+    }
+    if (!requested)
+    {
+        mode = STHS34PF80_POWER_NORMAL;
+    }
 
+    if (dev->oneshot)
+    {
+        /* already powered down between conversions, taken up on resume */
+        sths34pf80->Power = mode;
+        return RT_EOK;
+    }
+    if (STHS34PF80_SetPowerMode(sths34pf80, mode, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
     return RT_EOK;
 }
+static void _sths34pf80_frame_to_data(rt_sensor_t sensor, const STHS34PF80_Frame_t *frame,
+                                      rt_uint32_t timestamp, struct rt_sensor_data *data);
+
+static RT_SIZE_TYPE _sths34pf80_oneshot_get_data(rt_sensor_t sensor, struct rt_sensor_data *data)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Frame_t frame;
+    rt_int32_t timeout = rt_tick_from_millisecond(PKG_STHS34PF80_ONESHOT_TIMEOUT_MS);
+    int32_t ret;
+
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        STHS34PF80_STATS_CALL(&dev->obj, STHS34PF80_STAT_READ_ONESHOT, ret,
+                              STHS34PF80_ReadFrameOneShot(&dev->obj, &frame, (uint32_t)timeout));
+        if (ret != STHS34PF80_OK)
+        {
+            return 0;
+        }
+        _sths34pf80_frame_to_data(sensor, &frame, rt_sensor_get_ts(), data);
+        return 1;
+    }
+
+    /* DRDY is routed to the INT pin, sleep until the conversion is done */
+    rt_sem_control(&dev->oneshot_sem, RT_IPC_CMD_RESET, RT_NULL);
+    dev->oneshot_wait = 1;
+    if (STHS34PF80_TriggerOneShot(&dev->obj) != STHS34PF80_OK ||
+        rt_sem_take(&dev->oneshot_sem, timeout) != RT_EOK)
+    {
+        dev->oneshot_wait = 0;
+        return 0;
+    }
+    STHS34PF80_STATS_CALL(&dev->obj, STHS34PF80_STAT_READ_FRAME, ret, STHS34PF80_ReadFrame(&dev->obj, &frame));
+    if (ret != STHS34PF80_OK)
+    {
+        return 0;
+    }
+    _sths34pf80_frame_to_data(sensor, &frame, dev->irq_ts, data);
+    return 1;
+}
+
 static RT_SIZE_TYPE _sths34pf80_polling_get_data(rt_sensor_t sensor, struct rt_sensor_data *data)
 {
+    STHS34PF80_Object_t *sths34pf80 = &STHS34PF80_DEVICE(sensor)->obj;
     uint16_t val;
+    int32_t tobj;
+    int32_t ret = STHS34PF80_ERROR;
+
+    _sths34pf80_resync(STHS34PF80_DEVICE(sensor));
+    if (STHS34PF80_DEVICE(sensor)->oneshot)
+    {
+        return _sths34pf80_oneshot_get_data(sensor, data);
+    }
+
     switch(sensor->info.type)
     {
     case RT_SENSOR_CLASS_PROXIMITY:
-        STHS34PF80_ReadPresence(&sths34pf80, &val);
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_READ_PRESENCE, ret, STHS34PF80_ReadPresence(sths34pf80, &val));
         data->type = RT_SENSOR_CLASS_PROXIMITY;
         data->data.proximity = val;
         data->timestamp = rt_sensor_get_ts();
         break;
     case RT_SENSOR_CLASS_TEMP:
-        STHS34PF80_ReadTemperature(&sths34pf80, &val);
+        if (_sths34pf80_channel(sensor) == STHS34PF80_CHANNEL_TOBJECT)
+        {
+            STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_READ_OBJECT, ret, STHS34PF80_ReadObjectTemperature(sths34pf80, &tobj));
+            data->data.temp = STHS34PF80_DIV_ROUND(tobj, 10);
+        }
+        else
+        {
+            STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_READ_TEMPERATURE, ret, STHS34PF80_ReadTemperature(sths34pf80, &val));
+            data->data.temp = STHS34PF80_ConvertAmbient((int16_t)val, STHS34PF80_UNIT_DCELSIUS);
+        }
         data->type = RT_SENSOR_CLASS_TEMP;
-        data->data.temp = (int)(val*0.1);
         data->timestamp = rt_sensor_get_ts();
         break;
     case RT_SENSOR_CLASS_FORCE:
-        STHS34PF80_ReadMotion(&sths34pf80, &val);
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_READ_MOTION, ret, STHS34PF80_ReadMotion(sths34pf80, &val));
         data->type = RT_SENSOR_CLASS_FORCE;
         data->data.proximity = val;
         data->timestamp = rt_sensor_get_ts();
@@ -149,44 +680,451 @@ static RT_SIZE_TYPE _sths34pf80_polling_get_data(rt_sensor_t sensor, struct rt_s
     default:
         break;
     }
-    return 1;
+    return ret == STHS34PF80_OK ? 1 : 0;
+}
+static void _sths34pf80_frame_to_data(rt_sensor_t sensor, const STHS34PF80_Frame_t *frame,
+                                      rt_uint32_t timestamp, struct rt_sensor_data *data)
+{
+    data->type = sensor->info.type;
+    data->timestamp = timestamp;
+    switch(sensor->info.type)
+    {
+    case RT_SENSOR_CLASS_PROXIMITY:
+        data->data.proximity = (rt_uint16_t)frame->TPresence;
+        break;
+    case RT_SENSOR_CLASS_TEMP:
+        if (_sths34pf80_channel(sensor) == STHS34PF80_CHANNEL_TOBJECT)
+        {
+            data->data.temp = STHS34PF80_CompensateObject(frame->TObject, frame->TAmbient, STHS34PF80_UNIT_DCELSIUS);
+        }
+        else
+        {
+            data->data.temp = STHS34PF80_ConvertAmbient(frame->TAmbient, STHS34PF80_UNIT_DCELSIUS);
+        }
+        break;
+    case RT_SENSOR_CLASS_FORCE:
+        data->data.proximity = (rt_uint16_t)frame->TMotion;
+        break;
+    default:
+        break;
+    }
 }
+
+static RT_SIZE_TYPE _sths34pf80_fifo_get_data(rt_sensor_t sensor, struct rt_sensor_data *data, rt_size_t len)
+{
+    STHS34PF80_Fifo_t *fifo = &STHS34PF80_DEVICE(sensor)->fifo[_sths34pf80_channel(sensor)];
+    const STHS34PF80_Sample_t *sample;
+    rt_size_t count;
+    rt_size_t i;
+
+    /* no bus access here, the irq thread already read the frames; decoded
+     * from the ring slots straight into the caller's array */
+    count = STHS34PF80_FifoPeek(fifo);
+    if (count > len)
+    {
+        count = len;
+    }
+    for (i = 0; i < count; i++)
+    {
+        sample = STHS34PF80_FifoAt(fifo, i);
+        _sths34pf80_frame_to_data(sensor, &sample->Frame, sample->Timestamp, &data[i]);
+    }
+    STHS34PF80_FifoRelease(fifo, count);
+    return count;
+}
+
+static void sths34pf80_irq_callback(void *args)
+{
+    struct sths34pf80_device *dev = (struct sths34pf80_device *)args;
+
+    dev->irq_ts = rt_sensor_get_ts();
+    if (dev->oneshot_wait)
+    {
+        dev->oneshot_wait = 0;
+        rt_sem_release(&dev->oneshot_sem);
+        return;
+    }
+    rt_sem_release(&dev->irq_sem);
+}
+
+static void sths34pf80_irq_thread_entry(void *parameter)
+{
+    struct sths34pf80_device *dev = (struct sths34pf80_device *)parameter;
+    STHS34PF80_Sample_t sample;
+    rt_sensor_t sen;
+    rt_uint8_t i;
+    int32_t ret;
+
+    while (1)
+    {
+        /* a sensor that lost its configuration raises no INT, keep resyncing */
+        if (rt_sem_take(&dev->irq_sem, dev->obj.ResyncPending ?
+                        rt_tick_from_millisecond(PKG_STHS34PF80_RESYNC_RETRY_MS) : RT_WAITING_FOREVER) != RT_EOK)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            _sths34pf80_resync(dev);
+            rt_mutex_release(&dev->lock);
+            continue;
+        }
+
+        rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+        /* one burst read also clears FUNC_STATUS and releases the INT line */
+        STHS34PF80_STATS_CALL(&dev->obj, STHS34PF80_STAT_READ_FRAME, ret, STHS34PF80_ReadFrame(&dev->obj, &sample.Frame));
+        _sths34pf80_resync(dev);
+        if (ret != STHS34PF80_OK)
+        {
+            rt_mutex_release(&dev->lock);
+            LOG_W("frame read failed");
+            continue;
+        }
+        sample.Timestamp = dev->irq_ts;
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+        /* right after the read, the conversion boundary the switch relies on */
+        if (dev->governed && STHS34PF80_GovUpdate(&dev->gov, &dev->obj, &sample.Frame) != STHS34PF80_OK)
+        {
+            LOG_W("governor odr switch failed");
+        }
+#endif
+
+        for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+        {
+            sen = dev->channel[i];
+            if (sen->config.mode == RT_SENSOR_MODE_INT)
+            {
+                STHS34PF80_FifoPush(&dev->fifo[i], &sample);
+                rt_hw_sensor_isr(sen);
+            }
+            else if (sen->config.mode == RT_SENSOR_MODE_FIFO)
+            {
+                /* wake the reader once per batch */
+                STHS34PF80_FifoPush(&dev->fifo[i], &sample);
+                if (STHS34PF80_FifoCount(&dev->fifo[i]) >= sen->info.fifo_max)
+                {
+                    rt_hw_sensor_isr(sen);
+                }
+            }
+        }
+        rt_mutex_release(&dev->lock);
+    }
+}
+
+static rt_err_t _sths34pf80_irq_init(struct sths34pf80_device *dev, struct rt_device_pin_mode *irq_pin)
+{
+    dev->irq_pin = irq_pin->pin;
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        return RT_EOK;
+    }
+
+    rt_sem_init(&dev->irq_sem, "sths_irq", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&dev->oneshot_sem, "sths_1s", 0, RT_IPC_FLAG_FIFO);
+    dev->irq_thread = rt_thread_create("sths_irq", sths34pf80_irq_thread_entry, dev,
+                                       PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE,
+                                       PKG_STHS34PF80_IRQ_THREAD_PRIORITY, 10);
+    if (dev->irq_thread == RT_NULL)
+    {
+        rt_sem_detach(&dev->irq_sem);
+        rt_sem_detach(&dev->oneshot_sem);
+        dev->irq_pin = RT_PIN_NONE;
+        return -RT_ENOMEM;
+    }
+    rt_thread_startup(dev->irq_thread);
+
+    /* INT is push-pull active high (CTRL3 defaults) */
+    rt_pin_mode(dev->irq_pin, irq_pin->mode);
+    return rt_pin_attach_irq(dev->irq_pin, PIN_IRQ_MODE_RISING, sths34pf80_irq_callback, dev);
+}
+
+static void _sths34pf80_irq_deinit(struct sths34pf80_device *dev)
+{
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        return;
+    }
+
+    rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_DISABLE);
+    rt_pin_detach_irq(dev->irq_pin);
+    if (dev->irq_thread != RT_NULL)
+    {
+        rt_thread_delete(dev->irq_thread);
+        dev->irq_thread = RT_NULL;
+    }
+    rt_sem_detach(&dev->irq_sem);
+    rt_sem_detach(&dev->oneshot_sem);
+    dev->irq_pin = RT_PIN_NONE;
+}
+
+/* batching needs every sample, and object temperature has no flag of its own */
+static rt_bool_t _sths34pf80_wants_drdy(rt_uint8_t channel, rt_uint8_t mode)
+{
+    return mode == RT_SENSOR_MODE_FIFO ||
+           (mode == RT_SENSOR_MODE_INT && channel == STHS34PF80_CHANNEL_TOBJECT);
+}
+
 static rt_err_t _sths34pf80_set_mode(rt_sensor_t sensor, rt_uint8_t mode)
 {
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    rt_uint8_t channel = _sths34pf80_channel(sensor);
+    rt_uint8_t i;
+    int32_t ret = STHS34PF80_OK;
+
+    if (dev->oneshot && mode != RT_SENSOR_MODE_POLLING)
+    {
+        /* streaming needs the sensor running */
+        return -RT_EBUSY;
+    }
+
+    if (_sths34pf80_wants_drdy(channel, mode))
+    {
+        if (dev->irq_pin == RT_PIN_NONE)
+        {
+            return -RT_ERROR;
+        }
+        /* route DRDY to the INT pin */
+        if (STHS34PF80_RouteINT(sths34pf80, 0x01) != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+    }
+
+    if ((mode == RT_SENSOR_MODE_INT || mode == RT_SENSOR_MODE_FIFO) && dev->irq_pin != RT_PIN_NONE)
+    {
+        /* control() holds dev->lock, which the irq thread keeps across its
+         * pushes, so the producer is stopped; the consumer is the caller */
+        STHS34PF80_FifoReset(&dev->fifo[channel]);
+        if (!dev->irq_enabled)
+        {
+            rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_ENABLE);
+            dev->irq_enabled = 1;
+        }
+    }
+
+    if (mode == RT_SENSOR_MODE_INT)
+    {
+        /* keep DRDY routing while another channel or the governor needs every sample */
+        if (STHS34PF80_GOVERNED(dev))
+        {
+            return RT_EOK;
+        }
+        for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+        {
+            if (dev->channel[i] != sensor && _sths34pf80_wants_drdy(i, dev->channel[i]->config.mode))
+            {
+                return RT_EOK;
+            }
+        }
+    }
+
     switch(sensor->info.type)
     {
     case RT_SENSOR_CLASS_PROXIMITY:
         if(mode == RT_SENSOR_MODE_INT)
         {
-            STHS34PF80_ControlINT(&sths34pf80,2,1);
+            STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,2,1));
         }
         break;
     case RT_SENSOR_CLASS_TEMP:
-        if(mode == RT_SENSOR_MODE_INT)
+        if(mode == RT_SENSOR_MODE_INT && channel != STHS34PF80_CHANNEL_TOBJECT)
         {
-            STHS34PF80_ControlINT(&sths34pf80,0,1);
+            STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,0,1));
         }
         break;
     case RT_SENSOR_CLASS_FORCE:
         if(mode == RT_SENSOR_MODE_INT)
         {
-            STHS34PF80_ControlINT(&sths34pf80,1,1);
+            STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,1,1));
         }
         break;
     default:
         break;
     }
+    return ret == STHS34PF80_OK ? RT_EOK : -RT_ERROR;
+}
+/* no channel streams from the irq thread */
+static rt_bool_t _sths34pf80_all_polling(struct sths34pf80_device *dev)
+{
+    rt_uint8_t i;
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (dev->channel[i]->config.mode != RT_SENSOR_MODE_POLLING)
+        {
+            return RT_FALSE;
+        }
+    }
+    return RT_TRUE;
+}
+static rt_err_t _sths34pf80_set_oneshot(rt_sensor_t sensor, rt_uint8_t enable)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    uint8_t power;
+    int32_t ret;
+
+    if (enable == dev->oneshot)
+    {
+        return RT_EOK;
+    }
+    if (STHS34PF80_GOVERNED(dev) || !_sths34pf80_all_polling(dev))
+    {
+        return -RT_EBUSY;
+    }
+
+    if (enable)
+    {
+        /* Power keeps the mode continuous conversions resume in */
+        power = sths34pf80->Power;
+        ret = STHS34PF80_SetPowerMode(sths34pf80, STHS34PF80_POWER_DOWN, _sths34pf80_switch_timeout(sths34pf80));
+        sths34pf80->Power = power;
+        if (ret != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+        if (dev->irq_pin != RT_PIN_NONE)
+        {
+            /* DRDY on INT wakes the reader when the conversion completes */
+            if (STHS34PF80_RouteINT(sths34pf80, 0x01) != STHS34PF80_OK)
+            {
+                return -RT_ERROR;
+            }
+            if (!dev->irq_enabled)
+            {
+                rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_ENABLE);
+                dev->irq_enabled = 1;
+            }
+        }
+    }
+    else
+    {
+        if (dev->irq_pin != RT_PIN_NONE && STHS34PF80_RouteINT(sths34pf80, 0x00) != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+        if (STHS34PF80_SetPowerMode(sths34pf80, (STHS34PF80_Power_t)sths34pf80->Power, 0) != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+    }
+
+    dev->oneshot = enable;
     return RT_EOK;
 }
+static rt_err_t _sths34pf80_calibrate(struct sths34pf80_device *dev, rt_uint32_t samples)
+{
+    STHS34PF80_Calib_t calib;
+    int32_t ret;
+
+    /* frames are polled here, nothing else may consume DRDY meanwhile */
+    if (dev->oneshot || STHS34PF80_GOVERNED(dev) || !_sths34pf80_all_polling(dev))
+    {
+        return -RT_EBUSY;
+    }
+
+    STHS34PF80_CalibInit(&calib);
+    ret = STHS34PF80_Calibrate(&dev->obj, &calib, samples ? samples : PKG_STHS34PF80_CALIB_SAMPLES,
+                               rt_tick_from_millisecond(PKG_STHS34PF80_CALIB_TIMEOUT_MS));
+    if (ret == STHS34PF80_TIMEOUT)
+    {
+        return -RT_ETIMEOUT;
+    }
+    if (ret != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+
+    LOG_I("%s noise sigma %u/%u/%u, thresholds %u/%u/%u", dev->name,
+          STHS34PF80_WelfordSigma(&calib.Presence) >> 8, STHS34PF80_WelfordSigma(&calib.Motion) >> 8,
+          STHS34PF80_WelfordSigma(&calib.AmbShock) >> 8, dev->obj.Config.THS_Presence,
+          dev->obj.Config.THS_Motion, dev->obj.Config.THS_Temp_Shock);
+    return RT_EOK;
+}
+static rt_err_t _sths34pf80_set_profile(struct sths34pf80_device *dev, rt_uint32_t id)
+{
+    /* the image rewrites CTRL3 and restarts the ODR */
+    if (dev->oneshot || STHS34PF80_GOVERNED(dev) || !_sths34pf80_all_polling(dev))
+    {
+        return -RT_EBUSY;
+    }
+    if (STHS34PF80_ApplyProfile(&dev->obj, (STHS34PF80_ProfileId_t)id) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+static rt_err_t _sths34pf80_set_governor(struct sths34pf80_device *dev, rt_uint8_t enable)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+
+    if (enable == dev->governed)
+    {
+        return RT_EOK;
+    }
+    if (dev->oneshot)
+    {
+        return -RT_EBUSY;
+    }
+
+    if (enable)
+    {
+        /* every frame has to reach the irq thread */
+        if (dev->irq_pin == RT_PIN_NONE || !_sths34pf80_all_polling(dev))
+        {
+            return -RT_EBUSY;
+        }
+        if (STHS34PF80_RouteINT(sths34pf80, 0x01) != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+        STHS34PF80_GovInit(&dev->gov, sths34pf80, rt_tick_from_millisecond(PKG_STHS34PF80_GOV_QUIET_MS));
+        dev->governed = 1;
+        if (!dev->irq_enabled)
+        {
+            rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_ENABLE);
+            dev->irq_enabled = 1;
+        }
+        return RT_EOK;
+    }
+
+    /* stop feeding it first, then run at the active ODR again */
+    dev->governed = 0;
+    if (!_sths34pf80_all_polling(dev))
+    {
+        dev->governed = 1;
+        return -RT_EBUSY;
+    }
+    if (STHS34PF80_RouteINT(sths34pf80, 0x00) != STHS34PF80_OK ||
+        STHS34PF80_SetODR(sths34pf80, dev->gov.ActiveODR, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+#endif
+static RT_SIZE_TYPE _sths34pf80_locked_get_data(rt_sensor_t sensor, struct rt_sensor_data *data)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    RT_SIZE_TYPE count;
+
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    count = _sths34pf80_polling_get_data(sensor, data);
+    rt_mutex_release(&dev->lock);
+    return count;
+}
 static RT_SIZE_TYPE sths34pf80_fetch_data(struct rt_sensor_device *sensor, void *buf, rt_size_t len)
 {
     if (sensor->config.mode == RT_SENSOR_MODE_POLLING)
     {
-        return _sths34pf80_polling_get_data(sensor, buf);
+        return _sths34pf80_locked_get_data(sensor, buf);
     }
-    else if (sensor->config.mode == RT_SENSOR_MODE_INT)
+    else if (sensor->config.mode == RT_SENSOR_MODE_INT || sensor->config.mode == RT_SENSOR_MODE_FIFO)
     {
-        return _sths34pf80_polling_get_data(sensor, buf);
+        if (STHS34PF80_DEVICE(sensor)->irq_pin == RT_PIN_NONE)
+        {
+            return _sths34pf80_locked_get_data(sensor, buf);
+        }
+        return _sths34pf80_fifo_get_data(sensor, buf, len);
     }
     else
     {
@@ -194,14 +1132,19 @@ static RT_SIZE_TYPE sths34pf80_fetch_data(struct rt_sensor_device *sensor, void
     }
 }
 
-static rt_err_t sths34pf80_control(struct rt_sensor_device *sensor, int cmd, void *args)
+static rt_err_t _sths34pf80_control(struct rt_sensor_device *sensor, int cmd, void *args)
 {
+    STHS34PF80_Object_t *sths34pf80 = &STHS34PF80_DEVICE(sensor)->obj;
     rt_err_t result = RT_EOK;
 
+    _sths34pf80_resync(STHS34PF80_DEVICE(sensor));
     switch (cmd)
     {
     case RT_SENSOR_CTRL_GET_ID:
-        STHS34PF80_ReadID(&sths34pf80, args);
+        if (STHS34PF80_ReadID(sths34pf80, args) != STHS34PF80_OK)
+        {
+            result = -RT_ERROR;
+        }
         break;
     case RT_SENSOR_CTRL_SET_RANGE:
         result = -RT_ERROR;
@@ -213,16 +1156,66 @@ static rt_err_t sths34pf80_control(struct rt_sensor_device *sensor, int cmd, voi
         result = _sths34pf80_set_mode(sensor, (rt_uint32_t)args & 0xff);
         break;
     case RT_SENSOR_CTRL_SET_POWER:
-        result = -RT_ERROR;
+        result = _sths34pf80_set_power(sensor, (rt_uint32_t)args & 0xff);
         break;
     case RT_SENSOR_CTRL_SELF_TEST:
         result = -RT_ERROR;
         break;
+    case STHS34PF80_CTRL_SET_ONESHOT:
+        result = _sths34pf80_set_oneshot(sensor, (rt_uint32_t)args ? 1 : 0);
+        break;
+    case STHS34PF80_CTRL_CALIBRATE:
+        result = _sths34pf80_calibrate(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args);
+        break;
+    case STHS34PF80_CTRL_SET_PROFILE:
+        result = _sths34pf80_set_profile(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args);
+        break;
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    case STHS34PF80_CTRL_SET_GOVERNOR:
+        result = _sths34pf80_set_governor(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args ? 1 : 0);
+        break;
+#endif
+    case STHS34PF80_CTRL_GET_FAULTS:
+        rt_memcpy(args, &sths34pf80->Faults, sizeof(STHS34PF80_Faults_t));
+        break;
+#ifdef PKG_STHS34PF80_USING_STATS
+    case STHS34PF80_CTRL_GET_STATS:
+        rt_memcpy(args, &sths34pf80->Stats, sizeof(STHS34PF80_Stats_t));
+        break;
+    case STHS34PF80_CTRL_RESET_STATS:
+        STHS34PF80_StatsReset(&sths34pf80->Stats);
+        break;
+#endif
+#ifdef PKG_STHS34PF80_USING_TRACE
+    case STHS34PF80_CTRL_SET_TRACE:
+        if (args == RT_NULL)
+        {
+            STHS34PF80_SetFrameHook(sths34pf80, RT_NULL, RT_NULL);
+        }
+        else if (STHS34PF80_TraceStart((STHS34PF80_TraceRecorder_t *)args, sths34pf80, RT_TICK_PER_SECOND,
+                                       ((STHS34PF80_TraceRecorder_t *)args)->Write,
+                                       ((STHS34PF80_TraceRecorder_t *)args)->Arg) != STHS34PF80_OK)
+        {
+            result = -RT_ERROR;
+        }
+        break;
+#endif
     default:
         return -RT_ERROR;
     }
     return result;
 }
+static rt_err_t sths34pf80_control(struct rt_sensor_device *sensor, int cmd, void *args)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    rt_err_t result;
+
+    /* the irq thread may switch the ODR or resync at any frame */
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    result = _sths34pf80_control(sensor, cmd, args);
+    rt_mutex_release(&dev->lock);
+    return result;
+}
 
 static struct rt_sensor_ops sensor_ops =
 {
@@ -233,14 +1226,20 @@ static struct rt_sensor_ops sensor_ops =
 int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg)
 {
     rt_int8_t result;
-    rt_sensor_t sensor_presence = RT_NULL, sensor_temp = RT_NULL,sensor_motion = RT_NULL;
+    rt_sensor_t sensor_presence = RT_NULL, sensor_temp = RT_NULL,sensor_motion = RT_NULL, sensor_tobj = RT_NULL;
+    struct sths34pf80_device *dev = RT_NULL;
+    char tobj_name[RT_NAME_MAX];
     struct rt_sensor_module *module = RT_NULL;
+    rt_uint8_t i;
 
-    module = rt_calloc(1, sizeof(struct rt_sensor_module));
-    if (module == RT_NULL)
+    dev = rt_calloc(1, sizeof(struct sths34pf80_device));
+    if (dev == RT_NULL)
     {
         return -1;
     }
+    module = &dev->module;
+    dev->irq_pin = RT_PIN_NONE;
+    rt_mutex_init(&dev->lock, "sths_dev", RT_IPC_FLAG_PRIO);
     {
         sensor_presence = rt_calloc(1, sizeof(struct rt_sensor_device));
         if (sensor_presence == RT_NULL)
@@ -251,12 +1250,14 @@ int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg)
         sensor_presence->info.model      = "sths34pf80_presence";
         sensor_presence->info.unit       = RT_SENSOR_UNIT_CM;
         sensor_presence->info.intf_type  = RT_SENSOR_INTF_I2C;
+        sensor_presence->info.fifo_max   = PKG_STHS34PF80_FIFO_WATERMARK;
 
         rt_memcpy(&sensor_presence->config, cfg, sizeof(struct rt_sensor_config));
+        sensor_presence->config.irq_pin.pin = RT_PIN_NONE;   /* the driver owns the INT pin */
         sensor_presence->ops = &sensor_ops;
         sensor_presence->module = module;
 
-        result = rt_hw_sensor_register(sensor_presence, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX, RT_NULL);
+        result = rt_hw_sensor_register(sensor_presence, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX, RT_NULL);
         if (result != RT_EOK)
         {
             LOG_E("device register err code: %d", result);
@@ -266,19 +1267,21 @@ int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg)
     {
         sensor_temp = rt_calloc(1, sizeof(struct rt_sensor_device));
         if (sensor_temp == RT_NULL)
-            return -1;
+            goto __exit;
 
         sensor_temp->info.type       = RT_SENSOR_CLASS_TEMP;
         sensor_temp->info.vendor     = RT_SENSOR_VENDOR_STM;
         sensor_temp->info.model      = "sths34pf80_temp";
         sensor_temp->info.unit       = RT_SENSOR_UNIT_DCELSIUS;
         sensor_temp->info.intf_type  = RT_SENSOR_INTF_I2C;
+        sensor_temp->info.fifo_max   = PKG_STHS34PF80_FIFO_WATERMARK;
 
         rt_memcpy(&sensor_temp->config, cfg, sizeof(struct rt_sensor_config));
+        sensor_temp->config.irq_pin.pin = RT_PIN_NONE;   /* the driver owns the INT pin */
         sensor_temp->ops = &sensor_ops;
         sensor_temp->module = module;
 
-        result = rt_hw_sensor_register(sensor_temp, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX, RT_NULL);
+        result = rt_hw_sensor_register(sensor_temp, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX, RT_NULL);
         if (result != RT_EOK)
         {
             LOG_E("device register err code: %d", result);
@@ -288,36 +1291,86 @@ int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg)
     {
         sensor_motion = rt_calloc(1, sizeof(struct rt_sensor_device));
         if (sensor_motion == RT_NULL)
-            return -1;
+            goto __exit;
 
         sensor_motion->info.type       = RT_SENSOR_CLASS_FORCE;
         sensor_motion->info.vendor     = RT_SENSOR_VENDOR_STM;
         sensor_motion->info.model      = "sths34pf80_motion";
         sensor_motion->info.unit       = RT_SENSOR_UNIT_MN;
         sensor_motion->info.intf_type  = RT_SENSOR_INTF_I2C;
+        sensor_motion->info.fifo_max   = PKG_STHS34PF80_FIFO_WATERMARK;
 
         rt_memcpy(&sensor_motion->config, cfg, sizeof(struct rt_sensor_config));
+        sensor_motion->config.irq_pin.pin = RT_PIN_NONE;   /* the driver owns the INT pin */
         sensor_motion->ops = &sensor_ops;
         sensor_motion->module = module;
 
-        result = rt_hw_sensor_register(sensor_motion, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX,RT_NULL);
+        result = rt_hw_sensor_register(sensor_motion, name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX,RT_NULL);
         if (result != RT_EOK)
         {
             LOG_E("device register err code: %d", result);
             goto __exit;
         }
     }
+    {
+        sensor_tobj = rt_calloc(1, sizeof(struct rt_sensor_device));
+        if (sensor_tobj == RT_NULL)
+            goto __exit;
 
-    module->sen[0] = sensor_presence;
-    module->sen[1] = sensor_temp;
-    module->sen[2] = sensor_motion;
-    module->sen_num = 3;
+        sensor_tobj->info.type       = RT_SENSOR_CLASS_TEMP;
+        sensor_tobj->info.vendor     = RT_SENSOR_VENDOR_STM;
+        sensor_tobj->info.model      = "sths34pf80_tobj";
+        sensor_tobj->info.unit       = RT_SENSOR_UNIT_DCELSIUS;
+        sensor_tobj->info.intf_type  = RT_SENSOR_INTF_I2C;
+        sensor_tobj->info.fifo_max   = PKG_STHS34PF80_FIFO_WATERMARK;
 
-    if(_sths34pf80_init(&cfg->intf) != RT_EOK)
+        rt_memcpy(&sensor_tobj->config, cfg, sizeof(struct rt_sensor_config));
+        sensor_tobj->config.irq_pin.pin = RT_PIN_NONE;   /* the driver owns the INT pin */
+        sensor_tobj->ops = &sensor_ops;
+        sensor_tobj->module = module;
+
+        /* second temperature device of this sensor, registered as temp_o<name> */
+        rt_snprintf(tobj_name, sizeof(tobj_name), "o%s", name);
+        result = rt_hw_sensor_register(sensor_tobj, tobj_name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX, RT_NULL);
+        if (result != RT_EOK)
+        {
+            LOG_E("device register err code: %d", result);
+            goto __exit;
+        }
+    }
+
+    dev->channel[STHS34PF80_CHANNEL_PRESENCE] = sensor_presence;
+    dev->channel[STHS34PF80_CHANNEL_TEMP] = sensor_temp;
+    dev->channel[STHS34PF80_CHANNEL_MOTION] = sensor_motion;
+    dev->channel[STHS34PF80_CHANNEL_TOBJECT] = sensor_tobj;
+    /* the stock RT_SENSOR_MODULE_MAX of 3 leaves the object temperature out */
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM && i < RT_SENSOR_MODULE_MAX; i++)
+    {
+        module->sen[i] = dev->channel[i];
+    }
+    module->sen_num = i;
+
+    if(_sths34pf80_init(dev, &cfg->intf) != RT_EOK)
     {
         LOG_E("sensor init failed");
         goto __exit;
     }
+    if(_sths34pf80_irq_init(dev, &cfg->irq_pin) != RT_EOK)
+    {
+        LOG_E("sensor irq init failed");
+        goto __exit;
+    }
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    if (_sths34pf80_set_governor(dev, 1) != RT_EOK)
+    {
+        LOG_W("odr governor needs the INT pin, running at a fixed ODR");
+    }
+    rt_mutex_release(&dev->lock);
+#endif
+
+    rt_strncpy(dev->name, name, RT_NAME_MAX);
+    rt_list_insert_before(&sths34pf80_devices, &dev->node);
 
     LOG_I("sensor init success");
     return RT_EOK;
@@ -338,11 +1391,187 @@ __exit:
         rt_device_unregister(&sensor_motion->parent);
         rt_free(sensor_motion);
     }
-    if (module)
-        rt_free(module);
+    if(sensor_tobj)
+    {
+        rt_device_unregister(&sensor_tobj->parent);
+        rt_free(sensor_tobj);
+    }
+    _sths34pf80_irq_deinit(dev);
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+    _sths34pf80_bus_put(dev->sched);
+#endif
+    rt_mutex_detach(&dev->lock);
+    rt_free(dev);
 
     return -RT_ERROR;
 }
+#ifdef RT_USING_FINSH
+#ifdef PKG_STHS34PF80_USING_STATS
+static void _sths34pf80_stats_dump(struct sths34pf80_device *dev)
+{
+    const STHS34PF80_StatEntry_t *entry;
+    rt_uint32_t i;
+
+    rt_kprintf("%s @ 0x%02x (latency in clock units)\n", dev->name, dev->obj.IO.Address);
+    rt_kprintf("%-18s %8s %6s %6s %6s %6s %6s\n", "call", "calls", "errs", "min", "avg", "max", "p99");
+    for (i = 0; i < STHS34PF80_STAT_NUM; i++)
+    {
+        entry = &dev->obj.Stats.Entry[i];
+        if (entry->Calls == 0)
+        {
+            continue;
+        }
+        rt_kprintf("%-18s %8u %6u %6u %6u %6u %6u\n", STHS34PF80_StatsName((STHS34PF80_StatId_t)i),
+                   entry->Calls, entry->Errors, entry->Min, (rt_uint32_t)(entry->Sum / entry->Calls),
+                   entry->Max, STHS34PF80_StatsPercentile(entry, 99));
+    }
+}
+#endif
+
+static int sths34pf80_msh(int argc, char **argv)
+{
+    struct sths34pf80_device *dev;
+
+#ifdef PKG_STHS34PF80_USING_STATS
+    if (argc >= 2 && !rt_strcmp(argv[1], "stats"))
+    {
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (argc >= 3 && !rt_strcmp(argv[2], "reset"))
+            {
+                STHS34PF80_StatsReset(&dev->obj.Stats);
+            }
+            else
+            {
+                _sths34pf80_stats_dump(dev);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+#endif
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+    if (argc >= 2 && !rt_strcmp(argv[1], "bus"))
+    {
+        struct sths34pf80_bus *bus;
+        STHS34PF80_BusStats_t stats;
+
+        rt_kprintf("%-10s %4s %5s %10s %10s %10s %10s %6s\n", "bus", "refs", "depth", "data", "config",
+                   "batches", "shared", "errs");
+        rt_list_for_each_entry(bus, &sths34pf80_buses, node)
+        {
+            rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+            stats = bus->queue.Stats;
+            rt_mutex_release(&bus->lock);
+            rt_kprintf("%-10s %4u %2u/%-2u %10u %10u %10u %10u %6u\n", bus->name,
+                       bus->ref, stats.Depth, stats.PeakDepth, stats.Requests[STHS34PF80_BUS_PRIO_DATA],
+                       stats.Requests[STHS34PF80_BUS_PRIO_CONFIG], stats.Batches, stats.Shared, stats.Errors);
+        }
+        return 0;
+    }
+#endif
+    if (argc >= 2 && !rt_strcmp(argv[1], "faults"))
+    {
+        rt_kprintf("%-10s %8s %8s %8s %8s %8s %7s\n", "device", "errors", "retried", "failed", "recover",
+                   "resyncs", "pending");
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            rt_kprintf("%-10s %8u %8u %8u %8u %8u %7s\n", dev->name, dev->obj.Faults.Errors,
+                       dev->obj.Faults.Retried, dev->obj.Faults.Failed, dev->obj.Faults.Recoveries,
+                       dev->obj.Faults.Resyncs, dev->obj.ResyncPending ? "yes" : "no");
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    if (argc >= 2 && !rt_strcmp(argv[1], "governor"))
+    {
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (argc >= 3 && _sths34pf80_set_governor(dev, !rt_strcmp(argv[2], "on")) != RT_EOK)
+            {
+                rt_kprintf("%s: cannot switch the governor %s\n", dev->name, argv[2]);
+            }
+            rt_kprintf("%s: governor %s, %s at ODR %u (idle %u, active %u), %u frames, %u up, %u down\n",
+                       dev->name, dev->governed ? "on" : "off", dev->gov.Active ? "active" : "idle",
+                       dev->obj.Config.ODR, dev->gov.IdleODR, dev->gov.ActiveODR, dev->gov.Frames,
+                       dev->gov.StepsUp, dev->gov.StepsDown);
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+#endif
+    if (argc >= 2 && !rt_strcmp(argv[1], "calib"))
+    {
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (_sths34pf80_calibrate(dev, argc >= 3 ? atoi(argv[2]) : 0) != RT_EOK)
+            {
+                rt_kprintf("%s: calibration failed\n", dev->name);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && !rt_strcmp(argv[1], "profile"))
+    {
+        const STHS34PF80_Profile_t *profile;
+        rt_uint32_t id;
+
+        if (argc < 3)
+        {
+            for (id = 0; id < STHS34PF80_PROFILE_NUM; id++)
+            {
+                rt_kprintf("%u: %s\n", id, STHS34PF80_ProfileGet((STHS34PF80_ProfileId_t)id)->Name);
+            }
+            return 0;
+        }
+        profile = STHS34PF80_ProfileFind(argv[2]);
+        if (profile == RT_NULL)
+        {
+            rt_kprintf("unknown profile %s\n", argv[2]);
+            return -1;
+        }
+        id = (rt_uint32_t)(profile - STHS34PF80_ProfileGet(STHS34PF80_PROFILE_DEFAULT));
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (_sths34pf80_set_profile(dev, id) != RT_EOK)
+            {
+                rt_kprintf("%s: cannot apply %s\n", dev->name, profile->Name);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+
+    rt_kprintf("Usage:\n");
+#ifdef PKG_STHS34PF80_USING_STATS
+    rt_kprintf("sths34pf80 stats [reset]    - show or clear per-call statistics\n");
+#endif
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+    rt_kprintf("sths34pf80 bus              - show the shared bus queues\n");
+#endif
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+    rt_kprintf("sths34pf80 governor [on|off] - show or switch the adaptive ODR\n");
+#endif
+    rt_kprintf("sths34pf80 faults           - show bus fault and resync counters\n");
+    rt_kprintf("sths34pf80 calib [samples]  - derive thresholds from a quiet window\n");
+    rt_kprintf("sths34pf80 profile [name]   - list or apply a configuration profile\n");
+    rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+    {
+        rt_kprintf("  device: %s\n", dev->name);
+    }
+    return 0;
+}
+MSH_CMD_EXPORT_ALIAS(sths34pf80_msh, sths34pf80, sths34pf80 sensor diagnostics);
+#endif
+
 int sths34pf80_port(void)
 {
     uint8_t STHS34PF80_ADDR_DEFAULT = 0x5A;
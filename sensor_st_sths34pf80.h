@@ -13,6 +13,19 @@
 #include "rtdevice.h"
 #include "stdint.h"
 #include "sths34pf80.h"
+#include "sths34pf80_fifo.h"
+#include "sths34pf80_conv.h"
+#include "sths34pf80_calib.h"
+#include "sths34pf80_profile.h"
+#ifdef PKG_STHS34PF80_USING_TRACE
+#include "sths34pf80_trace.h"
+#endif
+#ifdef PKG_STHS34PF80_USING_BUS_QUEUE
+#include "sths34pf80_bus.h"
+#endif
+#ifdef PKG_STHS34PF80_USING_GOVERNOR
+#include "sths34pf80_gov.h"
+#endif
 #include <rtdbg.h>
 
 #if defined(RT_VERSION_CHECK)
@@ -23,6 +36,23 @@
     #endif
 #endif
 
+/* OR into cfg->intf.user_data to force one transfer per register on buses
+ * whose controller cannot do multi-byte register transfers. */
+#define STHS34PF80_INTF_SINGLE_BYTE     0x100
+
+/* sths34pf80_control user commands */
+#define STHS34PF80_CTRL_GET_STATS       (RT_SENSOR_CTRL_USER_CMD_START + 1)  /* args: STHS34PF80_Stats_t *, copied out */
+#define STHS34PF80_CTRL_RESET_STATS     (RT_SENSOR_CTRL_USER_CMD_START + 2)
+#define STHS34PF80_CTRL_SET_ONESHOT     (RT_SENSOR_CTRL_USER_CMD_START + 3)  /* args: 1 on-demand, 0 free-running */
+#define STHS34PF80_CTRL_SET_TRACE       (RT_SENSOR_CTRL_USER_CMD_START + 4)  /* args: STHS34PF80_TraceRecorder_t * with Write/Arg set, RT_NULL stops */
+#define STHS34PF80_CTRL_CALIBRATE       (RT_SENSOR_CTRL_USER_CMD_START + 5)  /* args: quiet window in frames, 0 for the default */
+#define STHS34PF80_CTRL_SET_PROFILE     (RT_SENSOR_CTRL_USER_CMD_START + 6)  /* args: STHS34PF80_ProfileId_t */
+#define STHS34PF80_CTRL_SET_GOVERNOR    (RT_SENSOR_CTRL_USER_CMD_START + 7)  /* args: 1 adaptive ODR, 0 fixed */
+#define STHS34PF80_CTRL_GET_FAULTS      (RT_SENSOR_CTRL_USER_CMD_START + 8)  /* args: STHS34PF80_Faults_t *, copied out */
+#define STHS34PF80_CTRL_SET_ODR         (RT_SENSOR_CTRL_USER_CMD_START + 9)  /* args: Hz, sensor framework v2 (v1 has RT_SENSOR_CTRL_SET_ODR) */
+
+rt_err_t sths34pf80_bus_recover(struct rt_i2c_bus_device *bus);
+
 int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg);
 
 
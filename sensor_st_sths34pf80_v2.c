@@ -0,0 +1,1062 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <stdlib.h>
+#include "sensor_st_sths34pf80.h"
+
+#define DBG_TAG "sensor.st.sths34pf80"
+#define DBG_LVL DBG_LOG
+
+
+#ifndef PKG_STHS34PF80_FIFO_WATERMARK
+#define PKG_STHS34PF80_FIFO_WATERMARK           (STHS34PF80_FIFO_DEPTH / 2)
+#endif
+#ifndef PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE
+#define PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE    1024
+#endif
+#ifndef PKG_STHS34PF80_IRQ_THREAD_PRIORITY
+#define PKG_STHS34PF80_IRQ_THREAD_PRIORITY      10
+#endif
+#ifndef PKG_STHS34PF80_PROFILE
+#define PKG_STHS34PF80_PROFILE                  STHS34PF80_PROFILE_DEFAULT
+#endif
+#ifndef PKG_STHS34PF80_WARM_START_REBOOT
+#define PKG_STHS34PF80_WARM_START_REBOOT        0       /* 1: CTRL2.BOOT before any reprogramming */
+#endif
+#ifndef PKG_STHS34PF80_CALIB_SAMPLES
+#define PKG_STHS34PF80_CALIB_SAMPLES            150     /* 10 s at the default 15 Hz */
+#endif
+#ifndef PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS
+#define PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS     20      /* on top of one frame when stopping conversions */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_COUNT
+#define PKG_STHS34PF80_RETRY_COUNT              2       /* retries of a failed transfer */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_BACKOFF_MS
+#define PKG_STHS34PF80_RETRY_BACKOFF_MS         1       /* before the first retry, doubled for each next one */
+#endif
+#ifndef PKG_STHS34PF80_RETRY_BUDGET_MS
+#define PKG_STHS34PF80_RETRY_BUDGET_MS          20      /* give up on a transfer failing for this long */
+#endif
+#ifndef PKG_STHS34PF80_RESYNC_RETRY_MS
+#define PKG_STHS34PF80_RESYNC_RETRY_MS          1000    /* irq thread, while a resync keeps failing */
+#endif
+#ifndef PKG_STHS34PF80_CALIB_TIMEOUT_MS
+#define PKG_STHS34PF80_CALIB_TIMEOUT_MS         4500    /* one frame at the slowest ODR */
+#endif
+
+/* sensor channels, in registration order */
+enum
+{
+    STHS34PF80_CHANNEL_PRESENCE = 0,
+    STHS34PF80_CHANNEL_TEMP,
+    STHS34PF80_CHANNEL_MOTION,
+    STHS34PF80_CHANNEL_TOBJECT,     /* in module.sen only when RT_SENSOR_MODULE_MAX allows 4 */
+    STHS34PF80_CHANNEL_NUM
+};
+
+/* what each channel registers as; temperatures are in 0.01 degC steps */
+static const struct
+{
+    rt_uint8_t          type;
+    rt_uint8_t          unit;
+    const char         *name;
+    rt_sensor_float_t   resolution;
+    rt_sensor_float_t   range_min;
+    rt_sensor_float_t   range_max;
+} sths34pf80_channels[STHS34PF80_CHANNEL_NUM] =
+{
+    { RT_SENSOR_TYPE_PROXIMITY, RT_SENSOR_UNIT_NONE,    "sths34pf80_presence", 1.0f,  -32768.0f, 32767.0f },
+    { RT_SENSOR_TYPE_TEMP,      RT_SENSOR_UNIT_CELSIUS, "sths34pf80_temp",     0.01f, -40.0f,    85.0f    },
+    { RT_SENSOR_TYPE_FORCE,     RT_SENSOR_UNIT_NONE,    "sths34pf80_motion",   1.0f,  -32768.0f, 32767.0f },
+    { RT_SENSOR_TYPE_TEMP,      RT_SENSOR_UNIT_CELSIUS, "sths34pf80_tobj",     0.01f, -40.0f,    85.0f    },
+};
+
+/* RT_SENSOR_MODE_ACCURACY_HIGHEST..LOWEST: more averaging and lower cutoffs
+ * lower the noise, at the cost of response time and the highest ODR */
+static const struct
+{
+    rt_uint8_t          avg_tmos;
+    rt_uint8_t          lpf_m;
+    rt_uint8_t          lpf_p;
+} sths34pf80_accuracy[RT_SENSOR_MODE_ACCURACY_NOTRUST] =
+{
+    { 0x04, 0x04, 0x04 },   /* AVG_TMOS 256, ODR/200, at most 4 Hz */
+    { 0x03, 0x04, 0x04 },   /* AVG_TMOS 128, at most 8 Hz */
+    { 0x02, 0x04, 0x04 },   /* the default profile */
+    { 0x01, 0x01, 0x02 },   /* AVG_TMOS 8, ODR/20 and ODR/50 */
+    { 0x00, 0x00, 0x01 },   /* AVG_TMOS 2, ODR/9 and ODR/20 */
+};
+
+struct sths34pf80_device
+{
+    struct rt_sensor_module     module;     /* shared by the channels of one sensor */
+    rt_sensor_t                 channel[STHS34PF80_CHANNEL_NUM];
+    STHS34PF80_Object_t         obj;
+    struct rt_i2c_bus_device   *bus;
+    char                        name[RT_NAME_MAX];
+    rt_list_t                   node;       /* entry in sths34pf80_devices */
+    struct rt_mutex             lock;       /* guards obj: irq thread, control and msh */
+
+    /* interrupt acquisition */
+    rt_base_t                   irq_pin;
+    rt_uint8_t                  irq_enabled;
+    struct rt_semaphore         irq_sem;
+    rt_thread_t                 irq_thread;
+    volatile rt_uint32_t        irq_ts;     /* taken in the ISR, closest to the event */
+
+    /* one SPSC ring per channel: irq thread produces, channel reader consumes */
+    STHS34PF80_Fifo_t           fifo[STHS34PF80_CHANNEL_NUM];
+};
+
+#define STHS34PF80_DEVICE(sensor)   rt_container_of((sensor)->module, struct sths34pf80_device, module)
+
+/* every successfully initialised sensor, for the msh command */
+static rt_list_t sths34pf80_devices = RT_LIST_OBJECT_INIT(sths34pf80_devices);
+
+static rt_uint8_t _sths34pf80_channel(rt_sensor_t sensor)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    rt_uint8_t i;
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (dev->channel[i] == sensor)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+/* a closed channel keeps the mode it was last opened in but takes no samples */
+static rt_uint8_t _sths34pf80_fetch(rt_sensor_t sensor)
+{
+    if (!(sensor->parent.open_flag & RT_DEVICE_OFLAG_OPEN))
+    {
+        return RT_SENSOR_MODE_FETCH_POLLING;
+    }
+    return RT_SENSOR_MODE_GET_FETCH(sensor->config.mode);
+}
+
+static int32_t i2c_init(void)
+{
+    return 0;
+}
+
+static int32_t sths34pf80_get_tick(void)
+{
+    return rt_tick_get();
+}
+
+static void sths34pf80_delay(uint32_t ticks)
+{
+    rt_thread_delay(ticks);
+}
+
+static int rt_i2c_write_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+    rt_uint8_t tmp = reg;
+    struct rt_i2c_msg msgs[2];
+
+    msgs[0].addr  = addr;             /* Slave address */
+    msgs[0].flags = RT_I2C_WR;        /* Write flag */
+    msgs[0].buf   = &tmp;             /* Slave register address */
+    msgs[0].len   = 1;                /* Number of bytes sent */
+
+    msgs[1].addr  = addr;             /* Slave address */
+    msgs[1].flags = RT_I2C_WR | RT_I2C_NO_START;        /* Read flag */
+    msgs[1].buf   = data;             /* Read data pointer */
+    msgs[1].len   = len;              /* Number of bytes read */
+
+    if (rt_i2c_transfer((struct rt_i2c_bus_device *)bus, msgs, 2) != 2)
+    {
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+static int rt_i2c_read_reg(void *bus, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+    rt_uint8_t tmp = reg;
+    struct rt_i2c_msg msgs[2];
+
+    msgs[0].addr  = addr;             /* Slave address */
+    msgs[0].flags = RT_I2C_WR;        /* Write flag */
+    msgs[0].buf   = &tmp;             /* Slave register address */
+    msgs[0].len   = 1;                /* Number of bytes sent */
+
+    msgs[1].addr  = addr;             /* Slave address */
+    msgs[1].flags = RT_I2C_RD;        /* Read flag */
+    msgs[1].buf   = data;             /* Read data pointer */
+    msgs[1].len   = len;              /* Number of bytes read */
+
+    if (rt_i2c_transfer((struct rt_i2c_bus_device *)bus, msgs, 2) != 2)
+    {
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+/* Frees a stuck bus before a transfer is retried, see the sensor v1 glue.
+ * Boards override it; it runs with the bus locked. */
+rt_weak rt_err_t sths34pf80_bus_recover(struct rt_i2c_bus_device *bus)
+{
+    (void)bus;
+    return -RT_ENOSYS;
+}
+
+static int32_t rt_i2c_recover(void *bus)
+{
+    struct rt_i2c_bus_device *i2c = (struct rt_i2c_bus_device *)bus;
+    rt_err_t ret;
+
+    rt_mutex_take(&i2c->lock, RT_WAITING_FOREVER);
+    ret = sths34pf80_bus_recover(i2c);
+    rt_mutex_release(&i2c->lock);
+
+    return ret == RT_EOK ? STHS34PF80_OK : STHS34PF80_ERROR;
+}
+
+/* wait for the conversion in progress before powering down */
+static rt_int32_t _sths34pf80_switch_timeout(STHS34PF80_Object_t *sths34pf80)
+{
+    uint8_t odr;
+
+    if (sths34pf80_ctrl1_odr_get(&sths34pf80->Ctx, &odr) != STHS34PF80_OK)
+    {
+        odr = sths34pf80->Config.ODR;
+    }
+    return rt_tick_from_millisecond(STHS34PF80_ODRPeriodMs(odr) + PKG_STHS34PF80_ODR_SWITCH_MARGIN_MS);
+}
+
+static rt_err_t _sths34pf80_init(struct sths34pf80_device *dev, struct rt_sensor_intf *intf)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_IO_t io_ctx;
+#ifdef PKG_STHS34PF80_USING_WARM_START
+    STHS34PF80_WarmResult_t warm;
+#else
+    rt_uint8_t        id;
+#endif
+
+    dev->bus = (struct rt_i2c_bus_device *)rt_device_find(intf->dev_name);
+    if (dev->bus == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+
+    if ((rt_uint32_t)(intf->arg) & STHS34PF80_INTF_SINGLE_BYTE)
+    {
+        io_ctx.BusType = STHS34PF80_I2C_BUS;       /* I2C, one register per transfer */
+    }
+    else
+    {
+        io_ctx.BusType = STHS34PF80_I2C_BURST_BUS; /* I2C, auto-increment burst */
+    }
+    io_ctx.Address     = (rt_uint32_t)(intf->arg) & 0xff;
+    io_ctx.Init        = i2c_init;
+    io_ctx.DeInit      = i2c_init;
+    io_ctx.Handle      = dev->bus;
+    io_ctx.ReadReg     = rt_i2c_read_reg;
+    io_ctx.WriteReg    = rt_i2c_write_reg;
+    io_ctx.Recover     = rt_i2c_recover;
+    io_ctx.GetTick     = sths34pf80_get_tick;
+    io_ctx.Delay       = sths34pf80_delay;
+
+    if (STHS34PF80_RegisterBusIO(sths34pf80, &io_ctx) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    STHS34PF80_SetRetryPolicy(sths34pf80, PKG_STHS34PF80_RETRY_COUNT,
+                              rt_tick_from_millisecond(PKG_STHS34PF80_RETRY_BACKOFF_MS),
+                              rt_tick_from_millisecond(PKG_STHS34PF80_RETRY_BUDGET_MS));
+#ifdef PKG_STHS34PF80_USING_WARM_START
+    /* the sensor may have kept its power and configuration across our reset */
+    if (STHS34PF80_WarmStart(sths34pf80, &STHS34PF80_ProfileGet(PKG_STHS34PF80_PROFILE)->Image,
+                             PKG_STHS34PF80_WARM_START_REBOOT, &warm) != STHS34PF80_OK)
+    {
+        rt_kprintf("sths34pf80 warm start failed\n");
+        return -RT_ERROR;
+    }
+    LOG_I("warm start: %s", warm == STHS34PF80_WARM_VERIFIED ? "configuration kept" :
+                            warm == STHS34PF80_WARM_CTRL3 ? "CTRL3 rewritten" :
+                            warm == STHS34PF80_WARM_REPROGRAMMED ? "reprogrammed" : "rebooted");
+#else
+    if (STHS34PF80_ReadID(sths34pf80, &id) != STHS34PF80_OK)
+    {
+        rt_kprintf("read id failed\n");
+        return -RT_ERROR;
+    }
+    /* one precomputed register image, written without reads */
+    if (STHS34PF80_ApplyProfile(sths34pf80, PKG_STHS34PF80_PROFILE) != STHS34PF80_OK)
+    {
+        rt_kprintf("sths34pf80 init failed\n");
+        return -RT_ERROR;
+    }
+#endif
+
+    /* no channel is open yet, opening one powers the sensor up */
+    if (STHS34PF80_SetPowerMode(sths34pf80, STHS34PF80_POWER_DOWN, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+/* a transfer failed: put back the configuration the registers should hold */
+static void _sths34pf80_resync(struct sths34pf80_device *dev)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_WarmResult_t result;
+
+    if (!sths34pf80->ResyncPending)
+    {
+        return;
+    }
+    if (STHS34PF80_Resync(sths34pf80, &result) != STHS34PF80_OK)
+    {
+        LOG_W("%s: resync failed, %u transfers given up", dev->name, sths34pf80->Faults.Failed);
+    }
+    else if (result != STHS34PF80_WARM_VERIFIED)
+    {
+        LOG_W("%s: configuration restored after a bus fault (%s)", dev->name,
+              result == STHS34PF80_WARM_CTRL3 ? "CTRL3 rewritten" :
+              result == STHS34PF80_WARM_REPROGRAMMED ? "reprogrammed" : "rebooted");
+    }
+}
+/* odr in Hz, rounded up to the next rate the sensor has */
+static rt_err_t _sths34pf80_set_odr(struct sths34pf80_device *dev, rt_uint16_t odr)
+{
+    /* whole Hz of each ODR code, 0.25 and 0.5 Hz round down */
+    static const rt_uint8_t odr_hz[9] = { 0, 0, 0, 1, 2, 4, 8, 15, 30 };
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    uint8_t code;
+    int32_t ret;
+
+    for (code = 1; code < STHS34PF80_MaxODR(sths34pf80->Config.AVG_TMOS); code++)
+    {
+        if (odr_hz[code] >= odr)
+        {
+            break;
+        }
+    }
+
+    STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_SET_ODR, ret,
+                          STHS34PF80_SetODR(sths34pf80, code, _sths34pf80_switch_timeout(sths34pf80)));
+
+    return ret == STHS34PF80_OK ? RT_EOK : -RT_ERROR;
+}
+/* the channels share one sensor: it runs in the most active mode any of them
+ * asks for, and stops converting once all of them are down (closed) */
+static rt_err_t _sths34pf80_set_power(rt_sensor_t sensor, rt_uint8_t power)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_Power_t mode = STHS34PF80_POWER_DOWN;
+    rt_uint8_t request;
+    rt_uint8_t i;
+
+    if (power > RT_SENSOR_MODE_POWER_DOWN)
+    {
+        return -RT_EINVAL;
+    }
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        request = dev->channel[i] == sensor ? power : RT_SENSOR_MODE_GET_POWER(dev->channel[i]->config.mode);
+        switch (request)
+        {
+        case RT_SENSOR_MODE_POWER_HIGHEST:
+        case RT_SENSOR_MODE_POWER_HIGH:
+        case RT_SENSOR_MODE_POWER_MEDIUM:
+            mode = STHS34PF80_POWER_NORMAL;
+            break;
+        case RT_SENSOR_MODE_POWER_LOW:
+        case RT_SENSOR_MODE_POWER_LOWEST:
+            mode = mode == STHS34PF80_POWER_NORMAL ? mode : STHS34PF80_POWER_LOW;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (STHS34PF80_SetPowerMode(sths34pf80, mode, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+/* averaging and low-pass filters, shared by the channels: the last request wins */
+static rt_err_t _sths34pf80_set_accuracy(rt_sensor_t sensor, rt_uint8_t accuracy)
+{
+    STHS34PF80_Object_t *sths34pf80 = &STHS34PF80_DEVICE(sensor)->obj;
+    STHS34PF80_Config_t config;
+    uint8_t max;
+
+    if (accuracy >= RT_SENSOR_MODE_ACCURACY_NOTRUST)
+    {
+        return -RT_EINVAL;
+    }
+
+    config = sths34pf80->Config;
+    config.AVG_TMOS = sths34pf80_accuracy[accuracy].avg_tmos;
+    config.LPF_Motion = sths34pf80_accuracy[accuracy].lpf_m;
+    config.LPF_Presence = sths34pf80_accuracy[accuracy].lpf_p;
+    max = STHS34PF80_MaxODR(config.AVG_TMOS);
+    if (config.ODR > max)
+    {
+        LOG_I("ODR %u lowered to %u for AVG_TMOS %u", config.ODR, max, config.AVG_TMOS);
+        config.ODR = max;
+    }
+
+    if (STHS34PF80_ApplyConfig(sths34pf80, &config, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+
+static void _sths34pf80_frame_to_data(struct sths34pf80_device *dev, rt_uint8_t channel,
+                                      const STHS34PF80_Frame_t *frame, rt_uint32_t timestamp,
+                                      struct rt_sensor_data *data)
+{
+    data->type = dev->channel[channel]->info.type;
+    data->timestamp = timestamp;
+    switch (channel)
+    {
+    case STHS34PF80_CHANNEL_PRESENCE:
+        data->data.proximity = frame->TPresence;
+        break;
+    case STHS34PF80_CHANNEL_TEMP:
+        data->data.temp = (rt_sensor_float_t)STHS34PF80_ConvertAmbient(frame->TAmbient, STHS34PF80_UNIT_CCELSIUS) / 100;
+        break;
+    case STHS34PF80_CHANNEL_MOTION:
+        data->data.force = frame->TMotion;
+        break;
+    case STHS34PF80_CHANNEL_TOBJECT:
+        data->data.temp = (rt_sensor_float_t)STHS34PF80_CompensateObject(frame->TObject, frame->TAmbient,
+                                                                         STHS34PF80_UNIT_CCELSIUS) / 100;
+        break;
+    default:
+        break;
+    }
+}
+
+static rt_ssize_t _sths34pf80_polling_get_data(rt_sensor_t sensor, struct rt_sensor_data *data)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Frame_t frame;
+    int32_t ret;
+
+    /* one burst read serves every channel, the frame is decoded in place */
+    _sths34pf80_resync(dev);
+    STHS34PF80_STATS_CALL(&dev->obj, STHS34PF80_STAT_READ_FRAME, ret, STHS34PF80_ReadFrame(&dev->obj, &frame));
+    if (ret != STHS34PF80_OK)
+    {
+        return 0;
+    }
+    _sths34pf80_frame_to_data(dev, _sths34pf80_channel(sensor), &frame, rt_sensor_get_ts(), data);
+    return 1;
+}
+
+static rt_ssize_t _sths34pf80_fifo_get_data(rt_sensor_t sensor, struct rt_sensor_data *data, rt_size_t len)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    rt_uint8_t channel = _sths34pf80_channel(sensor);
+    STHS34PF80_Fifo_t *fifo = &dev->fifo[channel];
+    const STHS34PF80_Sample_t *sample;
+    rt_size_t count;
+    rt_size_t i;
+
+    /* no bus access here, the irq thread already read the frames; decoded
+     * from the ring slots straight into the caller's array */
+    count = STHS34PF80_FifoPeek(fifo);
+    if (count > len)
+    {
+        count = len;
+    }
+    for (i = 0; i < count; i++)
+    {
+        sample = STHS34PF80_FifoAt(fifo, i);
+        _sths34pf80_frame_to_data(dev, channel, &sample->Frame, sample->Timestamp, &data[i]);
+    }
+    STHS34PF80_FifoRelease(fifo, count);
+    return count;
+}
+
+static void sths34pf80_irq_callback(void *args)
+{
+    struct sths34pf80_device *dev = (struct sths34pf80_device *)args;
+
+    dev->irq_ts = rt_sensor_get_ts();
+    rt_sem_release(&dev->irq_sem);
+}
+
+static void sths34pf80_irq_thread_entry(void *parameter)
+{
+    struct sths34pf80_device *dev = (struct sths34pf80_device *)parameter;
+    STHS34PF80_Sample_t sample;
+    rt_sensor_t sen;
+    rt_uint8_t i;
+    int32_t ret;
+
+    while (1)
+    {
+        /* a sensor that lost its configuration raises no INT, keep resyncing */
+        if (rt_sem_take(&dev->irq_sem, dev->obj.ResyncPending ?
+                        rt_tick_from_millisecond(PKG_STHS34PF80_RESYNC_RETRY_MS) : RT_WAITING_FOREVER) != RT_EOK)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            _sths34pf80_resync(dev);
+            rt_mutex_release(&dev->lock);
+            continue;
+        }
+
+        rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+        /* one burst read also clears FUNC_STATUS and releases the INT line */
+        STHS34PF80_STATS_CALL(&dev->obj, STHS34PF80_STAT_READ_FRAME, ret, STHS34PF80_ReadFrame(&dev->obj, &sample.Frame));
+        _sths34pf80_resync(dev);
+        if (ret != STHS34PF80_OK)
+        {
+            rt_mutex_release(&dev->lock);
+            LOG_W("frame read failed");
+            continue;
+        }
+        sample.Timestamp = dev->irq_ts;
+
+        for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+        {
+            sen = dev->channel[i];
+            if (_sths34pf80_fetch(sen) == RT_SENSOR_MODE_FETCH_INT)
+            {
+                STHS34PF80_FifoPush(&dev->fifo[i], &sample);
+                rt_hw_sensor_isr(sen);
+            }
+            else if (_sths34pf80_fetch(sen) == RT_SENSOR_MODE_FETCH_FIFO)
+            {
+                /* wake the reader once per batch */
+                STHS34PF80_FifoPush(&dev->fifo[i], &sample);
+                if (STHS34PF80_FifoCount(&dev->fifo[i]) >= sen->info.fifo_max)
+                {
+                    rt_hw_sensor_isr(sen);
+                }
+            }
+        }
+        rt_mutex_release(&dev->lock);
+    }
+}
+
+static rt_err_t _sths34pf80_irq_init(struct sths34pf80_device *dev, struct rt_device_pin_mode *irq_pin)
+{
+    dev->irq_pin = irq_pin->pin;
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        return RT_EOK;
+    }
+
+    rt_sem_init(&dev->irq_sem, "sths_irq", 0, RT_IPC_FLAG_FIFO);
+    dev->irq_thread = rt_thread_create("sths_irq", sths34pf80_irq_thread_entry, dev,
+                                       PKG_STHS34PF80_IRQ_THREAD_STACK_SIZE,
+                                       PKG_STHS34PF80_IRQ_THREAD_PRIORITY, 10);
+    if (dev->irq_thread == RT_NULL)
+    {
+        rt_sem_detach(&dev->irq_sem);
+        dev->irq_pin = RT_PIN_NONE;
+        return -RT_ENOMEM;
+    }
+    rt_thread_startup(dev->irq_thread);
+
+    /* INT is push-pull active high (CTRL3 defaults) */
+    rt_pin_mode(dev->irq_pin, irq_pin->mode);
+    return rt_pin_attach_irq(dev->irq_pin, PIN_IRQ_MODE_RISING, sths34pf80_irq_callback, dev);
+}
+
+static void _sths34pf80_irq_deinit(struct sths34pf80_device *dev)
+{
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        return;
+    }
+
+    rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_DISABLE);
+    rt_pin_detach_irq(dev->irq_pin);
+    if (dev->irq_thread != RT_NULL)
+    {
+        rt_thread_delete(dev->irq_thread);
+        dev->irq_thread = RT_NULL;
+    }
+    rt_sem_detach(&dev->irq_sem);
+    dev->irq_pin = RT_PIN_NONE;
+}
+
+/* batching needs every sample, and object temperature has no flag of its own */
+static rt_bool_t _sths34pf80_wants_drdy(rt_uint8_t channel, rt_uint8_t fetch)
+{
+    return fetch == RT_SENSOR_MODE_FETCH_FIFO ||
+           (fetch == RT_SENSOR_MODE_FETCH_INT && channel == STHS34PF80_CHANNEL_TOBJECT);
+}
+
+static rt_err_t _sths34pf80_set_fetch(rt_sensor_t sensor, rt_uint8_t fetch)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    rt_uint8_t channel = _sths34pf80_channel(sensor);
+    rt_uint8_t i;
+    int32_t ret = STHS34PF80_OK;
+
+    if (fetch == RT_SENSOR_MODE_FETCH_POLLING)
+    {
+        return RT_EOK;
+    }
+    if (fetch != RT_SENSOR_MODE_FETCH_INT && fetch != RT_SENSOR_MODE_FETCH_FIFO)
+    {
+        return -RT_EINVAL;
+    }
+    /* samples reach the ring only through the irq thread */
+    if (dev->irq_pin == RT_PIN_NONE)
+    {
+        return -RT_ENOSYS;
+    }
+
+    if (_sths34pf80_wants_drdy(channel, fetch))
+    {
+        /* route DRDY to the INT pin */
+        if (STHS34PF80_RouteINT(sths34pf80, 0x01) != STHS34PF80_OK)
+        {
+            return -RT_ERROR;
+        }
+    }
+
+    /* control() holds dev->lock, which the irq thread keeps across its
+     * pushes, so the producer is stopped; the consumer is the caller */
+    STHS34PF80_FifoReset(&dev->fifo[channel]);
+    if (!dev->irq_enabled)
+    {
+        rt_pin_irq_enable(dev->irq_pin, PIN_IRQ_ENABLE);
+        dev->irq_enabled = 1;
+    }
+
+    if (fetch == RT_SENSOR_MODE_FETCH_FIFO || channel == STHS34PF80_CHANNEL_TOBJECT)
+    {
+        return RT_EOK;
+    }
+    /* keep DRDY routing while another channel needs every sample */
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (dev->channel[i] != sensor && _sths34pf80_wants_drdy(i, _sths34pf80_fetch(dev->channel[i])))
+        {
+            return RT_EOK;
+        }
+    }
+
+    switch (channel)
+    {
+    case STHS34PF80_CHANNEL_PRESENCE:
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,2,1));
+        break;
+    case STHS34PF80_CHANNEL_TEMP:
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,0,1));
+        break;
+    case STHS34PF80_CHANNEL_MOTION:
+        STHS34PF80_STATS_CALL(sths34pf80, STHS34PF80_STAT_CONTROL_INT, ret, STHS34PF80_ControlINT(sths34pf80,1,1));
+        break;
+    default:
+        break;
+    }
+    return ret == STHS34PF80_OK ? RT_EOK : -RT_ERROR;
+}
+/* no channel streams from the irq thread */
+static rt_bool_t _sths34pf80_all_polling(struct sths34pf80_device *dev)
+{
+    rt_uint8_t i;
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (_sths34pf80_fetch(dev->channel[i]) != RT_SENSOR_MODE_FETCH_POLLING)
+        {
+            return RT_FALSE;
+        }
+    }
+    return RT_TRUE;
+}
+static rt_err_t _sths34pf80_calibrate(struct sths34pf80_device *dev, rt_uint32_t samples)
+{
+    STHS34PF80_Object_t *sths34pf80 = &dev->obj;
+    STHS34PF80_Calib_t calib;
+    uint8_t power = sths34pf80->Power;
+    int32_t ret;
+
+    /* frames are polled here, nothing else may consume DRDY meanwhile */
+    if (!_sths34pf80_all_polling(dev))
+    {
+        return -RT_EBUSY;
+    }
+    /* no channel open: convert for the calibration only */
+    if (power == STHS34PF80_POWER_DOWN &&
+        STHS34PF80_SetPowerMode(sths34pf80, STHS34PF80_POWER_NORMAL, 0) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+
+    STHS34PF80_CalibInit(&calib);
+    ret = STHS34PF80_Calibrate(sths34pf80, &calib, samples ? samples : PKG_STHS34PF80_CALIB_SAMPLES,
+                               rt_tick_from_millisecond(PKG_STHS34PF80_CALIB_TIMEOUT_MS));
+    if (power == STHS34PF80_POWER_DOWN &&
+        STHS34PF80_SetPowerMode(sths34pf80, STHS34PF80_POWER_DOWN, _sths34pf80_switch_timeout(sths34pf80)) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    if (ret == STHS34PF80_TIMEOUT)
+    {
+        return -RT_ETIMEOUT;
+    }
+    if (ret != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+
+    LOG_I("%s noise sigma %u/%u/%u, thresholds %u/%u/%u", dev->name,
+          STHS34PF80_WelfordSigma(&calib.Presence) >> 8, STHS34PF80_WelfordSigma(&calib.Motion) >> 8,
+          STHS34PF80_WelfordSigma(&calib.AmbShock) >> 8, sths34pf80->Config.THS_Presence,
+          sths34pf80->Config.THS_Motion, sths34pf80->Config.THS_Temp_Shock);
+    return RT_EOK;
+}
+static rt_err_t _sths34pf80_set_profile(struct sths34pf80_device *dev, rt_uint32_t id)
+{
+    /* the image rewrites CTRL3 and restarts the ODR */
+    if (!_sths34pf80_all_polling(dev))
+    {
+        return -RT_EBUSY;
+    }
+    if (STHS34PF80_ApplyProfile(&dev->obj, (STHS34PF80_ProfileId_t)id) != STHS34PF80_OK)
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+static rt_ssize_t sths34pf80_fetch_data(rt_sensor_t sensor, rt_sensor_data_t buf, rt_size_t len)
+{
+    rt_uint8_t fetch = RT_SENSOR_MODE_GET_FETCH(sensor->config.mode);
+    rt_ssize_t count;
+
+    if (len == 0)
+    {
+        return 0;
+    }
+    if ((fetch == RT_SENSOR_MODE_FETCH_INT || fetch == RT_SENSOR_MODE_FETCH_FIFO) &&
+        STHS34PF80_DEVICE(sensor)->irq_pin != RT_PIN_NONE)
+    {
+        return _sths34pf80_fifo_get_data(sensor, buf, len);
+    }
+
+    rt_mutex_take(&STHS34PF80_DEVICE(sensor)->lock, RT_WAITING_FOREVER);
+    count = _sths34pf80_polling_get_data(sensor, buf);
+    rt_mutex_release(&STHS34PF80_DEVICE(sensor)->lock);
+    return count;
+}
+
+static rt_err_t _sths34pf80_control(rt_sensor_t sensor, int cmd, void *args)
+{
+    STHS34PF80_Object_t *sths34pf80 = &STHS34PF80_DEVICE(sensor)->obj;
+    rt_err_t result = RT_EOK;
+
+    _sths34pf80_resync(STHS34PF80_DEVICE(sensor));
+    switch (cmd)
+    {
+    case RT_SENSOR_CTRL_GET_ID:
+        if (STHS34PF80_ReadID(sths34pf80, args) != STHS34PF80_OK)
+        {
+            result = -RT_ERROR;
+        }
+        break;
+    case RT_SENSOR_CTRL_SET_FETCH_MODE:
+        result = _sths34pf80_set_fetch(sensor, (rt_uint32_t)args & 0xff);
+        break;
+    case RT_SENSOR_CTRL_SET_POWER_MODE:
+        result = _sths34pf80_set_power(sensor, (rt_uint32_t)args & 0xff);
+        break;
+    case RT_SENSOR_CTRL_SET_ACCURACY_MODE:
+        result = _sths34pf80_set_accuracy(sensor, (rt_uint32_t)args & 0xff);
+        break;
+    case STHS34PF80_CTRL_SET_ODR:
+        result = _sths34pf80_set_odr(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args & 0xffff);
+        break;
+    case STHS34PF80_CTRL_CALIBRATE:
+        result = _sths34pf80_calibrate(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args);
+        break;
+    case STHS34PF80_CTRL_SET_PROFILE:
+        result = _sths34pf80_set_profile(STHS34PF80_DEVICE(sensor), (rt_uint32_t)args);
+        break;
+    case STHS34PF80_CTRL_GET_FAULTS:
+        rt_memcpy(args, &sths34pf80->Faults, sizeof(STHS34PF80_Faults_t));
+        break;
+#ifdef PKG_STHS34PF80_USING_STATS
+    case STHS34PF80_CTRL_GET_STATS:
+        rt_memcpy(args, &sths34pf80->Stats, sizeof(STHS34PF80_Stats_t));
+        break;
+    case STHS34PF80_CTRL_RESET_STATS:
+        STHS34PF80_StatsReset(&sths34pf80->Stats);
+        break;
+#endif
+    default:
+        return -RT_ERROR;
+    }
+    return result;
+}
+static rt_err_t sths34pf80_control(rt_sensor_t sensor, int cmd, void *args)
+{
+    struct sths34pf80_device *dev = STHS34PF80_DEVICE(sensor);
+    rt_err_t result;
+
+    /* the irq thread may resync at any frame */
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    result = _sths34pf80_control(sensor, cmd, args);
+    rt_mutex_release(&dev->lock);
+    return result;
+}
+
+static struct rt_sensor_ops sensor_ops =
+{
+    sths34pf80_fetch_data,
+    sths34pf80_control
+};
+
+int rt_hw_sths34pf80_init(const char *name, struct rt_sensor_config *cfg)
+{
+    struct sths34pf80_device *dev;
+    rt_sensor_t sensor;
+    char dev_name[RT_NAME_MAX];
+    rt_err_t result;
+    rt_uint8_t i;
+
+    dev = rt_calloc(1, sizeof(struct sths34pf80_device));
+    if (dev == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    dev->irq_pin = RT_PIN_NONE;
+    rt_mutex_init(&dev->lock, "sths_dev", RT_IPC_FLAG_PRIO);
+
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        sensor = rt_calloc(1, sizeof(struct rt_sensor_device));
+        if (sensor == RT_NULL)
+        {
+            goto __exit;
+        }
+
+        sensor->info.type                 = sths34pf80_channels[i].type;
+        sensor->info.vendor               = RT_SENSOR_VENDOR_STM;
+        sensor->info.name                 = sths34pf80_channels[i].name;
+        sensor->info.unit                 = sths34pf80_channels[i].unit;
+        sensor->info.intf_type            = RT_SENSOR_INTF_I2C;
+        sensor->info.fifo_max             = PKG_STHS34PF80_FIFO_WATERMARK;
+        sensor->info.acquire_min          = 1000.0f / 30;     /* ms, at the fastest ODR */
+        sensor->info.accuracy.resolution  = sths34pf80_channels[i].resolution;
+        sensor->info.scale.range_min      = sths34pf80_channels[i].range_min;
+        sensor->info.scale.range_max      = sths34pf80_channels[i].range_max;
+
+        rt_memcpy(&sensor->config, cfg, sizeof(struct rt_sensor_config));
+        sensor->config.irq_pin.pin = RT_PIN_NONE;   /* the driver owns the INT pin */
+        /* closed: opening a channel selects its fetch mode and powers it up */
+        RT_SENSOR_MODE_SET_FETCH(sensor->config.mode, RT_SENSOR_MODE_FETCH_POLLING);
+        RT_SENSOR_MODE_SET_POWER(sensor->config.mode, RT_SENSOR_MODE_POWER_DOWN);
+        sensor->ops = &sensor_ops;
+        sensor->module = &dev->module;
+
+        /* object temperature is the second temperature device, temp_o<name> */
+        rt_snprintf(dev_name, sizeof(dev_name), i == STHS34PF80_CHANNEL_TOBJECT ? "o%s" : "%s", name);
+        result = rt_hw_sensor_register(sensor, dev_name, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX, RT_NULL);
+        if (result != RT_EOK)
+        {
+            LOG_E("device register err code: %d", result);
+            rt_free(sensor);
+            goto __exit;
+        }
+
+        dev->channel[i] = sensor;
+        if (i < RT_SENSOR_MODULE_MAX)
+        {
+            dev->module.sen[i] = sensor;
+            dev->module.sen_num++;
+        }
+    }
+
+    if (_sths34pf80_init(dev, &cfg->intf) != RT_EOK)
+    {
+        LOG_E("sensor init failed");
+        goto __exit;
+    }
+    if (_sths34pf80_irq_init(dev, &cfg->irq_pin) != RT_EOK)
+    {
+        LOG_E("sensor irq init failed");
+        goto __exit;
+    }
+
+    rt_strncpy(dev->name, name, RT_NAME_MAX);
+    rt_list_insert_before(&sths34pf80_devices, &dev->node);
+
+    LOG_I("sensor init success");
+    return RT_EOK;
+
+__exit:
+    for (i = 0; i < STHS34PF80_CHANNEL_NUM; i++)
+    {
+        if (dev->channel[i] != RT_NULL)
+        {
+            rt_device_unregister(&dev->channel[i]->parent);
+            rt_free(dev->channel[i]);
+        }
+    }
+    _sths34pf80_irq_deinit(dev);
+    rt_mutex_detach(&dev->lock);
+    rt_free(dev);
+
+    return -RT_ERROR;
+}
+#ifdef RT_USING_FINSH
+#ifdef PKG_STHS34PF80_USING_STATS
+static void _sths34pf80_stats_dump(struct sths34pf80_device *dev)
+{
+    const STHS34PF80_StatEntry_t *entry;
+    rt_uint32_t i;
+
+    rt_kprintf("%s @ 0x%02x (latency in clock units)\n", dev->name, dev->obj.IO.Address);
+    rt_kprintf("%-18s %8s %6s %6s %6s %6s %6s\n", "call", "calls", "errs", "min", "avg", "max", "p99");
+    for (i = 0; i < STHS34PF80_STAT_NUM; i++)
+    {
+        entry = &dev->obj.Stats.Entry[i];
+        if (entry->Calls == 0)
+        {
+            continue;
+        }
+        rt_kprintf("%-18s %8u %6u %6u %6u %6u %6u\n", STHS34PF80_StatsName((STHS34PF80_StatId_t)i),
+                   entry->Calls, entry->Errors, entry->Min, (rt_uint32_t)(entry->Sum / entry->Calls),
+                   entry->Max, STHS34PF80_StatsPercentile(entry, 99));
+    }
+}
+#endif
+
+static int sths34pf80_msh(int argc, char **argv)
+{
+    struct sths34pf80_device *dev;
+
+#ifdef PKG_STHS34PF80_USING_STATS
+    if (argc >= 2 && !rt_strcmp(argv[1], "stats"))
+    {
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (argc >= 3 && !rt_strcmp(argv[2], "reset"))
+            {
+                STHS34PF80_StatsReset(&dev->obj.Stats);
+            }
+            else
+            {
+                _sths34pf80_stats_dump(dev);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+#endif
+    if (argc >= 2 && !rt_strcmp(argv[1], "faults"))
+    {
+        rt_kprintf("%-10s %8s %8s %8s %8s %8s %7s\n", "device", "errors", "retried", "failed", "recover",
+                   "resyncs", "pending");
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            rt_kprintf("%-10s %8u %8u %8u %8u %8u %7s\n", dev->name, dev->obj.Faults.Errors,
+                       dev->obj.Faults.Retried, dev->obj.Faults.Failed, dev->obj.Faults.Recoveries,
+                       dev->obj.Faults.Resyncs, dev->obj.ResyncPending ? "yes" : "no");
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+    if (argc >= 2 && !rt_strcmp(argv[1], "calib"))
+    {
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (_sths34pf80_calibrate(dev, argc >= 3 ? atoi(argv[2]) : 0) != RT_EOK)
+            {
+                rt_kprintf("%s: calibration failed\n", dev->name);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && !rt_strcmp(argv[1], "profile"))
+    {
+        const STHS34PF80_Profile_t *profile;
+        rt_uint32_t id;
+
+        if (argc < 3)
+        {
+            for (id = 0; id < STHS34PF80_PROFILE_NUM; id++)
+            {
+                rt_kprintf("%u: %s\n", id, STHS34PF80_ProfileGet((STHS34PF80_ProfileId_t)id)->Name);
+            }
+            return 0;
+        }
+        profile = STHS34PF80_ProfileFind(argv[2]);
+        if (profile == RT_NULL)
+        {
+            rt_kprintf("unknown profile %s\n", argv[2]);
+            return -1;
+        }
+        id = (rt_uint32_t)(profile - STHS34PF80_ProfileGet(STHS34PF80_PROFILE_DEFAULT));
+        rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+        {
+            rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+            if (_sths34pf80_set_profile(dev, id) != RT_EOK)
+            {
+                rt_kprintf("%s: cannot apply %s\n", dev->name, profile->Name);
+            }
+            rt_mutex_release(&dev->lock);
+        }
+        return 0;
+    }
+
+    rt_kprintf("Usage:\n");
+#ifdef PKG_STHS34PF80_USING_STATS
+    rt_kprintf("sths34pf80 stats [reset]    - show or clear per-call statistics\n");
+#endif
+    rt_kprintf("sths34pf80 faults           - show bus fault and resync counters\n");
+    rt_kprintf("sths34pf80 calib [samples]  - derive thresholds from a quiet window\n");
+    rt_kprintf("sths34pf80 profile [name]   - list or apply a configuration profile\n");
+    rt_list_for_each_entry(dev, &sths34pf80_devices, node)
+    {
+        rt_kprintf("  device: %s\n", dev->name);
+    }
+    return 0;
+}
+MSH_CMD_EXPORT_ALIAS(sths34pf80_msh, sths34pf80, sths34pf80 sensor diagnostics);
+#endif
+
+int sths34pf80_port(void)
+{
+    uint8_t STHS34PF80_ADDR_DEFAULT = 0x5A;
+    struct rt_sensor_config cfg;
+
+    cfg.intf.dev_name = "i2c1";
+    cfg.intf.arg = (void *)STHS34PF80_ADDR_DEFAULT;
+    cfg.irq_pin.pin = RT_PIN_NONE;
+    cfg.irq_pin.mode = PIN_MODE_INPUT;
+    cfg.mode = 0;
+
+    rt_hw_sths34pf80_init("sths34pf80", &cfg);
+    return 0;
+}
+INIT_APP_EXPORT(sths34pf80_port);
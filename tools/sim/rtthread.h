@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_SIM_RTTHREAD_H_
+#define STHS34PF80_SIM_RTTHREAD_H_
+
+/* The few RT-Thread definitions the portable driver sources rely on, so they
+ * build unchanged on a host without a BSP. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RT_NULL     ((void *)0)
+#define RT_EOK      0
+#define RT_ERROR    1
+
+#endif /* STHS34PF80_SIM_RTTHREAD_H_ */
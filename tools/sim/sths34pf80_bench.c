@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sths34pf80_sim.h"
+#include "sths34pf80_async.h"
+#include "sths34pf80_profile.h"
+
+/* Bus cost of each public API: transactions, bytes and wire time per call.
+ *   sths34pf80_bench [overhead_us] [--csv]
+ * overhead_us is the fixed cost charged per transfer (controller setup, ISR,
+ * scheduler), 0 by default so the figures are pure wire time. */
+
+#define BENCH_REPEAT    16
+#define BENCH_SWITCH_TIMEOUT    100     /* ms, one conversion at the bench ODR and margin */
+
+typedef int32_t (*bench_func)(STHS34PF80_Object_t *pObj);
+
+typedef struct
+{
+    const char  *name;
+    bench_func   func;
+    uint8_t      cold;      /* measure on a freshly registered, uninitialized object */
+} bench_case_t;
+
+static int32_t bench_init(STHS34PF80_Object_t *pObj)
+{
+    pObj->is_initialized = 0;
+    return STHS34PF80_Init(pObj);
+}
+
+static int32_t bench_read_id(STHS34PF80_Object_t *pObj)
+{
+    uint8_t id;
+    return STHS34PF80_ReadID(pObj, &id);
+}
+
+static int32_t bench_read_presence(STHS34PF80_Object_t *pObj)
+{
+    uint16_t val;
+    return STHS34PF80_ReadPresence(pObj, &val);
+}
+
+static int32_t bench_read_motion(STHS34PF80_Object_t *pObj)
+{
+    uint16_t val;
+    return STHS34PF80_ReadMotion(pObj, &val);
+}
+
+static int32_t bench_read_temperature(STHS34PF80_Object_t *pObj)
+{
+    uint16_t val;
+    return STHS34PF80_ReadTemperature(pObj, &val);
+}
+
+static int32_t bench_read_object_temperature(STHS34PF80_Object_t *pObj)
+{
+    int32_t val;
+    return STHS34PF80_ReadObjectTemperature(pObj, &val);
+}
+
+static int32_t bench_read_flags(STHS34PF80_Object_t *pObj)
+{
+    uint16_t pres, mot, shock;
+
+    if (STHS34PF80_ReadPresenceFlag(pObj, &pres) != STHS34PF80_OK ||
+        STHS34PF80_ReadMotionFlag(pObj, &mot) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    return STHS34PF80_ReadTempShockFlag(pObj, &shock);
+}
+
+static int32_t bench_read_frame(STHS34PF80_Object_t *pObj)
+{
+    STHS34PF80_Frame_t frame;
+    return STHS34PF80_ReadFrame(pObj, &frame);
+}
+
+static int32_t bench_threshold_set(STHS34PF80_Object_t *pObj)
+{
+    return sths34pf80_threshold_set(&pObj->Ctx, STHS34PF80_PRESENCE_THS_L, 0x88);
+}
+
+static int32_t bench_set_thresholds(STHS34PF80_Object_t *pObj)
+{
+    return STHS34PF80_SetThresholds(pObj, 5000, 2300, 2000, BENCH_SWITCH_TIMEOUT);
+}
+
+static int32_t bench_get_thresholds(STHS34PF80_Object_t *pObj)
+{
+    uint16_t pres, mot, shock;
+    return STHS34PF80_GetThresholds(pObj, &pres, &mot, &shock);
+}
+
+/* what _sths34pf80_set_odr in the RT-Thread glue does, alternating 15 and 8 Hz */
+static int32_t bench_set_odr(STHS34PF80_Object_t *pObj)
+{
+    return STHS34PF80_SetODR(pObj, pObj->Config.ODR == 0x07 ? 0x06 : 0x07, 100);
+}
+
+/* RT_SENSOR_CTRL_SET_POWER: alternately suspend and resume */
+static int32_t bench_set_power_mode(STHS34PF80_Object_t *pObj)
+{
+    return STHS34PF80_SetPowerMode(pObj, pObj->Power == STHS34PF80_POWER_NORMAL ? STHS34PF80_POWER_DOWN
+                                                                                : STHS34PF80_POWER_NORMAL, 100);
+}
+
+/* on-demand acquisition: the first call also parks the sensor in power-down */
+static int32_t bench_read_frame_one_shot(STHS34PF80_Object_t *pObj)
+{
+    STHS34PF80_Frame_t frame;
+    uint8_t odr;
+
+    if (sths34pf80_ctrl1_odr_get(&pObj->Ctx, &odr) != STHS34PF80_OK ||
+        (odr != 0 && sths34pf80_ctrl1_odr_set(&pObj->Ctx, 0) != STHS34PF80_OK))
+    {
+        return STHS34PF80_ERROR;
+    }
+    return STHS34PF80_ReadFrameOneShot(pObj, &frame, 100);
+}
+
+/* completes every transfer in place, as a workqueue-backed glue does */
+static int32_t bench_async_submit(void *handle, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                                  uint8_t read, STHS34PF80_AsyncJob_t *job)
+{
+    int32_t ret = read ? STHS34PF80_SimReadReg(handle, addr, reg, data, len)
+                       : STHS34PF80_SimWriteReg(handle, addr, reg, data, len);
+    (void)job;
+    return ret == STHS34PF80_OK ? STHS34PF80_ASYNC_DONE : ret;
+}
+
+static void bench_async_done(STHS34PF80_AsyncJob_t *job, int32_t ret, void *arg)
+{
+    (void)job;
+    *(int32_t *)arg = ret;
+}
+
+static int32_t bench_async_set_thresholds(STHS34PF80_Object_t *pObj)
+{
+    STHS34PF80_Sim_t *sim = (STHS34PF80_Sim_t *)pObj->IO.Handle;
+    STHS34PF80_AsyncJob_t job;
+    int32_t ret = STHS34PF80_ERROR;
+
+    STHS34PF80_AsyncInit(&job, pObj, bench_async_submit, pObj->IO.Handle);
+    if (STHS34PF80_AsyncSetThresholds(&job, 5000, 2300, 2000, BENCH_SWITCH_TIMEOUT, bench_async_done, &ret) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    while (job.Busy)
+    {
+        /* the DRDY interrupt at the end of the conversion in progress */
+        STHS34PF80_SimAdvance(sim, (uint32_t)(sim->NextSampleUs - sim->NowUs));
+        STHS34PF80_AsyncResume(&job);
+    }
+    return ret;
+}
+
+static int32_t bench_async_read_frame(STHS34PF80_Object_t *pObj)
+{
+    STHS34PF80_AsyncJob_t job;
+    STHS34PF80_Frame_t frame;
+    int32_t ret = STHS34PF80_ERROR;
+
+    STHS34PF80_AsyncInit(&job, pObj, bench_async_submit, pObj->IO.Handle);
+    if (STHS34PF80_AsyncReadFrame(&job, &frame, bench_async_done, &ret) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    return ret;
+}
+
+static int32_t bench_sync_cache(STHS34PF80_Object_t *pObj)
+{
+    return STHS34PF80_SyncCache(pObj);
+}
+
+static int32_t bench_apply_profile(STHS34PF80_Object_t *pObj)
+{
+    static uint32_t next;
+
+    return STHS34PF80_ApplyProfile(pObj, (STHS34PF80_ProfileId_t)(next++ % STHS34PF80_PROFILE_NUM));
+}
+
+static int32_t bench_warm_start(STHS34PF80_Object_t *pObj)
+{
+    sths34pf80_image_t img;
+    STHS34PF80_WarmResult_t result;
+
+    STHS34PF80_BuildImage(&(pObj->Config), &img);
+    if (STHS34PF80_WarmStart(pObj, &img, 0, &result) != STHS34PF80_OK)
+    {
+        return STHS34PF80_ERROR;
+    }
+    return result == STHS34PF80_WARM_VERIFIED ? STHS34PF80_OK : STHS34PF80_ERROR;
+}
+
+static const bench_case_t bench_cases[] =
+{
+    { "STHS34PF80_Init",              bench_init,             1 },
+    { "STHS34PF80_ReadID",            bench_read_id,          0 },
+    { "STHS34PF80_ReadPresence",      bench_read_presence,    0 },
+    { "STHS34PF80_ReadMotion",        bench_read_motion,      0 },
+    { "STHS34PF80_ReadTemperature",   bench_read_temperature, 0 },
+    { "STHS34PF80_ReadObjectTemperature", bench_read_object_temperature, 0 },
+    { "STHS34PF80_Read*Flag x3",      bench_read_flags,       0 },
+    { "STHS34PF80_ReadFrame",         bench_read_frame,       0 },
+    { "STHS34PF80_ReadFrameOneShot",  bench_read_frame_one_shot, 0 },
+    { "sths34pf80_threshold_set",     bench_threshold_set,    0 },
+    { "STHS34PF80_SetThresholds",     bench_set_thresholds,   0 },
+    { "STHS34PF80_GetThresholds",     bench_get_thresholds,   0 },
+    { "STHS34PF80_AsyncSetThresholds", bench_async_set_thresholds, 0 },
+    { "STHS34PF80_AsyncReadFrame",    bench_async_read_frame, 0 },
+    { "STHS34PF80_SetODR",            bench_set_odr,          0 },
+    { "STHS34PF80_SetPowerMode",      bench_set_power_mode,   0 },
+    { "STHS34PF80_ApplyProfile",      bench_apply_profile,    0 },
+    { "STHS34PF80_WarmStart (intact)", bench_warm_start,      0 },
+    { "STHS34PF80_SyncCache",         bench_sync_cache,       0 },
+};
+
+static const uint32_t bench_clocks[] = { 100000, 400000, 1000000 };
+
+typedef struct
+{
+    double      transactions;
+    double      bytes;
+    double      wire_us;
+    uint32_t    violations;
+} bench_result_t;
+
+static void bench_setup(STHS34PF80_Sim_t *sim, STHS34PF80_Object_t *obj, uint32_t clock_hz, uint32_t overhead_us)
+{
+    STHS34PF80_IO_t io;
+
+    STHS34PF80_SimInit(sim);
+    STHS34PF80_SimSetBus(sim, clock_hz, overhead_us);
+    STHS34PF80_SimBindIO(sim, &io);
+
+    memset(obj, 0, sizeof(*obj));
+    obj->Config.LPF_Motion = 0x04;
+    obj->Config.LPF_Presence = 0x04;
+    obj->Config.LPF_Temperature = 0x02;
+    obj->Config.AVG_TMOS = 0x02;
+    obj->Config.ODR = 0x07;
+    obj->Config.THS_Presence = 5000;
+    obj->Config.THS_Motion = 2300;
+    obj->Config.THS_Temp_Shock = 2000;
+    STHS34PF80_RegisterBusIO(obj, &io);
+}
+
+static int bench_run(const bench_case_t *bc, uint32_t clock_hz, uint32_t overhead_us, bench_result_t *res)
+{
+    STHS34PF80_Sim_t sim;
+    STHS34PF80_Object_t obj;
+    uint32_t transactions, bytes, violations;
+    uint64_t wire_ns;
+    int i;
+
+    memset(res, 0, sizeof(*res));
+    bench_setup(&sim, &obj, clock_hz, overhead_us);
+
+    for (i = 0; i < BENCH_REPEAT; i++)
+    {
+        if (bc->cold)
+        {
+            /* every run starts from a reset sensor and an empty cache */
+            bench_setup(&sim, &obj, clock_hz, overhead_us);
+        }
+        else if (i == 0 && STHS34PF80_Init(&obj) != STHS34PF80_OK)
+        {
+            return -1;
+        }
+        STHS34PF80_SimAdvance(&sim, 100000);
+
+        transactions = sim.ReadTransactions + sim.WriteTransactions;
+        bytes = sim.BytesRead + sim.BytesWritten;
+        wire_ns = sim.WireNs;
+        violations = sim.Violations;
+
+        if (bc->func(&obj) != STHS34PF80_OK)
+        {
+            return -1;
+        }
+
+        res->transactions += sim.ReadTransactions + sim.WriteTransactions - transactions;
+        res->bytes += sim.BytesRead + sim.BytesWritten - bytes;
+        res->wire_us += (double)(sim.WireNs - wire_ns) / 1000.0;
+        res->violations += sim.Violations - violations;
+    }
+
+    res->transactions /= BENCH_REPEAT;
+    res->bytes /= BENCH_REPEAT;
+    res->wire_us /= BENCH_REPEAT;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bench_result_t res[sizeof(bench_clocks) / sizeof(bench_clocks[0])];
+    uint32_t overhead_us = 0;
+    int csv = 0, ret = 0, rc;
+    size_t c, k;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else
+        {
+            overhead_us = (uint32_t)strtoul(argv[i], NULL, 0);
+        }
+    }
+
+    if (csv)
+    {
+        printf("api,transactions,bytes,us_100k,us_400k,us_1m,violations\n");
+    }
+    else
+    {
+        printf("per-transfer overhead %u us, %d calls averaged\n\n", (unsigned)overhead_us, BENCH_REPEAT);
+        printf("%-32s %7s %7s %10s %10s %10s %5s\n", "api", "xfers", "bytes", "us@100k", "us@400k", "us@1M", "viol");
+    }
+
+    for (c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++)
+    {
+        for (k = 0; k < sizeof(bench_clocks) / sizeof(bench_clocks[0]); k++)
+        {
+            rc = bench_run(&bench_cases[c], bench_clocks[k], overhead_us, &res[k]);
+            if (rc != 0)
+            {
+                fprintf(stderr, "%s: call failed\n", bench_cases[c].name);
+                ret = 1;
+            }
+        }
+
+        /* violations: accesses the datasheet forbids, summed over all calls at 100 kHz */
+        printf(csv ? "%s,%.1f,%.1f,%.1f,%.1f,%.1f,%u\n" : "%-32s %7.1f %7.1f %10.1f %10.1f %10.1f %5u\n",
+               bench_cases[c].name, res[0].transactions, res[0].bytes,
+               res[0].wire_us, res[1].wire_us, res[2].wire_us, (unsigned)res[0].violations);
+        for (k = 0; k < sizeof(bench_clocks) / sizeof(bench_clocks[0]); k++)
+        {
+            if (res[k].violations != 0)
+            {
+                fprintf(stderr, "%s: %u datasheet violations\n", bench_cases[c].name, (unsigned)res[k].violations);
+                ret = 1;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <math.h>
+#include "sths34pf80_model.h"
+
+/* LPF register code to cutoff divisor, fc = ODR / div */
+static const uint16_t model_lpf_div[STHS34PF80_MODEL_LPF_CODES] = { 9, 20, 50, 100, 200, 400, 800 };
+
+/* first-order IIR coefficient for fc = fs / div */
+static float model_alpha(uint32_t div)
+{
+  return (float)(1.0 - exp(-2.0 * 3.14159265358979323846 / (double)div));
+}
+
+static float model_lpf_alpha(uint8_t code)
+{
+  if (code >= STHS34PF80_MODEL_LPF_CODES)
+  {
+    code = STHS34PF80_MODEL_LPF_CODES - 1;
+  }
+  return model_alpha(model_lpf_div[code]);
+}
+
+/**
+ * @brief  Parameters matching the configuration a trace was recorded with
+ */
+void STHS34PF80_ModelDefaults(STHS34PF80_ModelParam_t *param, const STHS34PF80_TraceHeader_t *header)
+{
+  memset(param, 0, sizeof(*param));
+  param->LPF_P = header->Config.LPF_Presence;
+  param->LPF_M = header->Config.LPF_Motion;
+  param->LPF_P_M = header->LPF_P_M;
+  param->THS_Presence = header->Config.THS_Presence;
+  param->THS_Motion = header->Config.THS_Motion;
+  param->HYST_Presence = header->HYST_Presence;
+  param->HYST_Motion = header->HYST_Motion;
+  param->BaseDiv = STHS34PF80_MODEL_BASE_DIV;
+}
+
+/**
+ * @brief  Load lanes parameter sets and settle every filter on the first sample
+ */
+void STHS34PF80_ModelInit(STHS34PF80_Model_t *model, const STHS34PF80_ModelParam_t *param, uint32_t lanes,
+                          float tobject)
+{
+  uint32_t i;
+
+  memset(model, 0, sizeof(*model));
+  model->Lanes = lanes;
+  /* unused lanes repeat the last set so the step loop has no tail */
+  for (i = 0; i < STHS34PF80_MODEL_LANES; i++)
+  {
+    const STHS34PF80_ModelParam_t *p = &param[i < lanes ? i : lanes - 1];
+
+    model->AlphaP[i] = model_lpf_alpha(p->LPF_P);
+    model->AlphaM[i] = model_lpf_alpha(p->LPF_M);
+    model->AlphaPM[i] = model_lpf_alpha(p->LPF_P_M);
+    model->AlphaBase[i] = model_alpha(p->BaseDiv);
+    model->ThsP[i] = p->THS_Presence;
+    model->ThsM[i] = p->THS_Motion;
+    model->ClearP[i] = (float)p->THS_Presence - p->HYST_Presence;
+    model->ClearM[i] = (float)p->THS_Motion - p->HYST_Motion;
+
+    model->LpfP[i] = tobject;
+    model->LpfM[i] = tobject;
+    model->LpfPM[i] = tobject;
+    model->Base[i] = tobject;
+  }
+}
+
+/**
+ * @brief  Run one TOBJECT sample through every lane
+ */
+void STHS34PF80_ModelStep(STHS34PF80_Model_t *model, float tobject)
+{
+  uint32_t i;
+
+  /* branch-free so the loop vectorizes: flags are 0/-1 masks */
+  for (i = 0; i < STHS34PF80_MODEL_LANES; i++)
+  {
+    float p, m, mag_p, mag_m;
+    int32_t set, clear;
+
+    model->LpfP[i] += model->AlphaP[i] * (tobject - model->LpfP[i]);
+    model->LpfM[i] += model->AlphaM[i] * (tobject - model->LpfM[i]);
+    model->LpfPM[i] += model->AlphaPM[i] * (tobject - model->LpfPM[i]);
+
+    p = model->LpfP[i] - model->Base[i];
+    m = model->LpfPM[i] - model->LpfM[i];
+    model->Presence[i] = p;
+    model->Motion[i] = m;
+
+    mag_p = p < 0 ? -p : p;
+    set = -(int32_t)(mag_p > model->ThsP[i]);
+    clear = -(int32_t)(mag_p < model->ClearP[i]);
+    model->FlagP[i] = set | (model->FlagP[i] & ~clear);
+
+    mag_m = m < 0 ? -m : m;
+    set = -(int32_t)(mag_m > model->ThsM[i]);
+    clear = -(int32_t)(mag_m < model->ClearM[i]);
+    model->FlagM[i] = set | (model->FlagM[i] & ~clear);
+
+    /* the baseline holds while somebody is there */
+    model->Base[i] += (model->FlagP[i] ? 0.0f : model->AlphaBase[i]) * (model->LpfP[i] - model->Base[i]);
+  }
+}
+
+/**
+ * @brief  FUNC_STATUS presence and motion bits of one lane
+ */
+uint8_t STHS34PF80_ModelFlags(const STHS34PF80_Model_t *model, uint32_t lane)
+{
+  return (uint8_t)((model->FlagP[lane] ? STHS34PF80_EVENT_PRESENCE : 0) |
+                   (model->FlagM[lane] ? STHS34PF80_EVENT_MOTION : 0));
+}
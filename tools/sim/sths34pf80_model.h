@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_MODEL_H_
+#define STHS34PF80_MODEL_H_
+
+#include "sths34pf80.h"
+#include "sths34pf80_trace.h"
+
+/* Host model of the embedded presence/motion algorithm, evaluated for
+ * STHS34PF80_MODEL_LANES parameter sets at once. Every per-sample step is a
+ * loop over lanes on structure-of-arrays state, which the compiler turns
+ * into SIMD code.
+ *
+ *   TMOTION    = LPF_P_M(TOBJECT) - LPF_M(TOBJECT)
+ *   TPRESENCE  = LPF_P(TOBJECT) - baseline, the baseline follows LPF_P(TOBJECT)
+ *                at ODR/BaseDiv and holds while presence is flagged
+ *   flags      set above THS, cleared below THS - HYST
+ *
+ * Each LPF is a first-order low-pass with the cutoff of its register code.
+ * The datasheet names the filters but not how they are combined: the motion
+ * difference and the baseline tracking above are assumptions, and the model
+ * is unvalidated until tune's check agrees with a hardware recording. */
+
+#ifndef STHS34PF80_MODEL_LANES
+#define STHS34PF80_MODEL_LANES      16
+#endif
+
+#define STHS34PF80_MODEL_LPF_CODES  7       /* ODR/9 .. ODR/800 */
+
+#ifndef STHS34PF80_MODEL_BASE_DIV
+#define STHS34PF80_MODEL_BASE_DIV   1600    /* assumed baseline time constant, samples */
+#endif
+
+typedef struct
+{
+    uint8_t     LPF_P;
+    uint8_t     LPF_M;
+    uint8_t     LPF_P_M;
+    uint16_t    THS_Presence;
+    uint16_t    THS_Motion;
+    uint8_t     HYST_Presence;
+    uint8_t     HYST_Motion;
+    uint16_t    BaseDiv;                    /* presence baseline time constant, samples */
+} STHS34PF80_ModelParam_t;
+
+typedef struct
+{
+    uint32_t    Lanes;                      /* parameter sets in use */
+    float       AlphaP[STHS34PF80_MODEL_LANES];
+    float       AlphaM[STHS34PF80_MODEL_LANES];
+    float       AlphaPM[STHS34PF80_MODEL_LANES];
+    float       AlphaBase[STHS34PF80_MODEL_LANES];
+    float       ThsP[STHS34PF80_MODEL_LANES];
+    float       ThsM[STHS34PF80_MODEL_LANES];
+    float       ClearP[STHS34PF80_MODEL_LANES];
+    float       ClearM[STHS34PF80_MODEL_LANES];
+
+    float       LpfP[STHS34PF80_MODEL_LANES];
+    float       LpfM[STHS34PF80_MODEL_LANES];
+    float       LpfPM[STHS34PF80_MODEL_LANES];
+    float       Base[STHS34PF80_MODEL_LANES];
+    float       Presence[STHS34PF80_MODEL_LANES];
+    float       Motion[STHS34PF80_MODEL_LANES];
+    int32_t     FlagP[STHS34PF80_MODEL_LANES];  /* 0 or -1 */
+    int32_t     FlagM[STHS34PF80_MODEL_LANES];
+} STHS34PF80_Model_t;
+
+void STHS34PF80_ModelDefaults(STHS34PF80_ModelParam_t *param, const STHS34PF80_TraceHeader_t *header);
+void STHS34PF80_ModelInit(STHS34PF80_Model_t *model, const STHS34PF80_ModelParam_t *param, uint32_t lanes,
+                          float tobject);
+void STHS34PF80_ModelStep(STHS34PF80_Model_t *model, float tobject);
+uint8_t STHS34PF80_ModelFlags(const STHS34PF80_Model_t *model, uint32_t lane);
+
+#endif /* STHS34PF80_MODEL_H_ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sths34pf80_sim.h"
+#include "sths34pf80_trace.h"
+
+/* Feed a recorded trace back through STHS34PF80_IO_t.ReadReg and run the
+ * driver over it in simulated time.
+ *   sths34pf80_replay <trace_file> [-v]
+ * Every conversion of the simulated sensor outputs the next recorded frame,
+ * FUNC_STATUS included, at the recorded ODR. */
+
+typedef struct
+{
+    STHS34PF80_TraceReader_t    reader;
+    STHS34PF80_Frame_t          frame;      /* output of the last conversion */
+    uint32_t                    timestamp;
+    uint32_t                    frames;
+    uint8_t                     done;
+} replay_t;
+
+static void replay_source(void *arg, uint32_t now_us, STHS34PF80_SimSignal_t *signal)
+{
+    replay_t *replay = (replay_t *)arg;
+
+    (void)now_us;
+    if (replay->done || STHS34PF80_TraceNext(&replay->reader, &replay->timestamp, &replay->frame) != STHS34PF80_OK)
+    {
+        replay->done = 1;
+        memset(&replay->frame, 0, sizeof(replay->frame));
+    }
+    else
+    {
+        replay->frames++;
+    }
+
+    signal->TObject = replay->frame.TObject;
+    signal->TAmbient = replay->frame.TAmbient;
+    signal->TPresence = replay->frame.TPresence;
+    signal->TMotion = replay->frame.TMotion;
+    signal->TAmbShock = replay->frame.TAmbShock;
+    signal->FuncStatus = replay->frame.FuncStatus;
+    signal->UseFlags = 1;
+}
+
+static uint8_t *load(const char *path, uint32_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = NULL;
+    long size;
+
+    if (f == NULL)
+    {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+    {
+        buf = malloc((size_t)size);
+        if (buf != NULL && fread(buf, 1, (size_t)size, f) != (size_t)size)
+        {
+            free(buf);
+            buf = NULL;
+        }
+        *len = (uint32_t)size;
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    STHS34PF80_Sim_t sim;
+    STHS34PF80_Object_t obj;
+    STHS34PF80_IO_t io;
+    STHS34PF80_Frame_t frame;
+    replay_t replay;
+    uint8_t *buf;
+    uint32_t len, ms, period_us, mismatches = 0, incidents = 0;
+    uint8_t events, last_events = 0, verbose = argc > 2 && !strcmp(argv[2], "-v");
+    clock_t wall;
+
+    if (argc < 2)
+    {
+        printf("usage: %s <trace_file> [-v]\n", argv[0]);
+        return 2;
+    }
+    buf = load(argv[1], &len);
+    memset(&replay, 0, sizeof(replay));
+    if (buf == NULL || STHS34PF80_TraceOpen(&replay.reader, buf, len) != STHS34PF80_OK)
+    {
+        printf("%s: not a trace\n", argv[1]);
+        return 1;
+    }
+
+    STHS34PF80_SimInit(&sim);
+    STHS34PF80_SimSetBus(&sim, 0, 0);
+    STHS34PF80_SimSetSource(&sim, replay_source, &replay);
+    STHS34PF80_SimBindIO(&sim, &io);
+
+    memset(&obj, 0, sizeof(obj));
+    obj.Config = replay.reader.Header.Config;
+    period_us = STHS34PF80_SimOdrPeriodUs(obj.Config.ODR);
+    if (period_us == 0 || STHS34PF80_RegisterBusIO(&obj, &io) != STHS34PF80_OK ||
+        STHS34PF80_Init(&obj) != STHS34PF80_OK || STHS34PF80_RouteINT(&obj, 0x01) != STHS34PF80_OK)
+    {
+        printf("cannot replay at ODR %u\n", obj.Config.ODR);
+        return 1;
+    }
+    printf("%s: ODR %u, LPF M/P/T %u/%u/%u, AVG_TMOS %u, THS P/M/S %u/%u/%u, %u Hz ticks\n", argv[1],
+           obj.Config.ODR, obj.Config.LPF_Motion, obj.Config.LPF_Presence, obj.Config.LPF_Temperature,
+           obj.Config.AVG_TMOS, obj.Config.THS_Presence, obj.Config.THS_Motion, obj.Config.THS_Temp_Shock,
+           (unsigned)replay.reader.Header.TickHz);
+
+    wall = clock();
+    while (!replay.done)
+    {
+        STHS34PF80_SimAdvance(&sim, period_us);
+        if (replay.done || !STHS34PF80_SimIntPin(&sim))
+        {
+            continue;
+        }
+        if (STHS34PF80_ReadFrame(&obj, &frame) != STHS34PF80_OK ||
+            STHS34PF80_ReadEvents(&obj, STHS34PF80_EVENT_ALL, &events) != STHS34PF80_OK)
+        {
+            printf("read failed\n");
+            return 1;
+        }
+
+        /* what the driver saw must be what was recorded */
+        if (frame.TObject != replay.frame.TObject || frame.TAmbient != replay.frame.TAmbient ||
+            frame.TPresence != replay.frame.TPresence || frame.TMotion != replay.frame.TMotion ||
+            frame.TAmbShock != replay.frame.TAmbShock || frame.FuncStatus != replay.frame.FuncStatus)
+        {
+            mismatches++;
+        }
+
+        ms = replay.reader.Header.TickHz != 0 ?
+             (uint32_t)((uint64_t)(replay.timestamp - replay.reader.Header.Start) * 1000U / replay.reader.Header.TickHz) : 0;
+        if (verbose || events != last_events)
+        {
+            if (events & ~last_events)
+            {
+                incidents++;
+            }
+            printf("%8u ms  tobj %6d  tamb %5d  pres %6d  mot %6d  shock %6d  events 0x%02x\n", (unsigned)ms,
+                   frame.TObject, frame.TAmbient, frame.TPresence, frame.TMotion, frame.TAmbShock, events);
+        }
+        last_events = events;
+    }
+    wall = clock() - wall;
+
+    printf("%u frames replayed, %u event onsets, %u mismatches, %u violations, %.1f ms of CPU\n",
+           (unsigned)replay.frames, (unsigned)incidents, (unsigned)mismatches, (unsigned)sim.Violations,
+           (double)wall * 1000.0 / CLOCKS_PER_SEC);
+
+    free(buf);
+    return mismatches != 0 || sim.Violations != 0;
+}
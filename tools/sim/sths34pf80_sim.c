@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include "sths34pf80_sim.h"
+
+#define SIM_CTRL2_ONE_SHOT          0x01U
+#define SIM_CTRL2_FUNC_CFG_ACCESS   0x10U
+#define SIM_CTRL2_BOOT              0x80U
+#define SIM_STATUS_DRDY             0x04U
+
+/* conversion time of a one-shot measurement */
+#define SIM_ONE_SHOT_US             12000U
+
+/* I2C bit times: START, address+W, register, [repeated START, address+R], data, STOP.
+ * Every byte is 8 bits plus ACK. */
+#define SIM_I2C_READ_BITS(len)      (1U + 9U + 9U + 1U + 9U + 9U * (len) + 1U)
+#define SIM_I2C_WRITE_BITS(len)     (1U + 9U + 9U + 9U * (len) + 1U)
+#define SIM_I2C_NACK_BITS           (1U + 9U + 1U)      /* start, address NACKed, stop */
+
+static STHS34PF80_Sim_t *sim_bound;
+
+/**
+ * @brief  Conversion period for a CTRL1.ODR code, 0 in power-down
+ */
+uint32_t STHS34PF80_SimOdrPeriodUs(uint8_t odr)
+{
+  static const uint32_t period_us[] =
+  {
+    0, 4000000, 2000000, 1000000, 500000, 250000, 125000, 66667, 33333
+  };
+
+  odr &= 0x0F;
+  if (odr >= sizeof(period_us) / sizeof(period_us[0]))
+  {
+    odr = sizeof(period_us) / sizeof(period_us[0]) - 1;
+  }
+  return period_us[odr];
+}
+
+static void sim_put_word(STHS34PF80_Sim_t *sim, uint8_t reg_l, int16_t val)
+{
+  sim->Reg[reg_l] = (uint16_t)val & 0xFF;
+  sim->Reg[reg_l + 1] = ((uint16_t)val >> 8) & 0xFF;
+}
+
+static uint16_t sim_embedded_word(STHS34PF80_Sim_t *sim, uint8_t addr_l)
+{
+  return (sim->Embedded[addr_l + 1] << 8 | sim->Embedded[addr_l]) & 0x7FFF;
+}
+
+/**
+ * @brief  Threshold detector with hysteresis, as the embedded algorithms flag it
+ */
+static void sim_detect(STHS34PF80_Sim_t *sim, int16_t val, uint8_t ths_l, uint8_t hyst, uint8_t bit)
+{
+  int32_t mag = val < 0 ? -(int32_t)val : val;
+  int32_t ths = sim_embedded_word(sim, ths_l);
+
+  if (mag > ths)
+  {
+    sim->Detect |= bit;
+  }
+  else if (mag < ths - (int32_t)sim->Embedded[hyst])
+  {
+    sim->Detect &= (uint8_t)~bit;
+  }
+}
+
+static void sim_convert(STHS34PF80_Sim_t *sim)
+{
+  STHS34PF80_SimSignal_t signal;
+
+  memset(&signal, 0, sizeof(signal));
+  signal.TAmbient = 2500;
+  if (sim->Source != NULL)
+  {
+    sim->Source(sim->SourceArg, (uint32_t)sim->NowUs, &signal);
+  }
+
+  sim_put_word(sim, STHS34PF80_TOBJECT_L, signal.TObject);
+  sim_put_word(sim, STHS34PF80_TAMBIENT_L, signal.TAmbient);
+  sim_put_word(sim, STHS34PF80_TPRESENCE_L, signal.TPresence);
+  sim_put_word(sim, STHS34PF80_TMOTION_L, signal.TMotion);
+  sim_put_word(sim, STHS34PF80_TAMB_SHOCK_L, signal.TAmbShock);
+
+  if (signal.UseFlags)
+  {
+    sim->Detect = signal.FuncStatus & STHS34PF80_EVENT_ALL;
+  }
+  else
+  {
+    sim_detect(sim, signal.TPresence, STHS34PF80_PRESENCE_THS_L, STHS34PF80_HYST_PRESENCE, STHS34PF80_EVENT_PRESENCE);
+    sim_detect(sim, signal.TMotion, STHS34PF80_MOTION_THS_L, STHS34PF80_HYST_MOTION, STHS34PF80_EVENT_MOTION);
+    sim_detect(sim, signal.TAmbShock, STHS34PF80_TAMBSHOCK_THS_L, STHS34PF80_HYST_TAMB_SHOCK, STHS34PF80_EVENT_TAMB_SHOCK);
+  }
+
+  /* flags stay set until FUNC_STATUS is read */
+  sim->Reg[STHS34PF80_FUNC_STATUS] |= sim->Detect;
+  sim->Reg[STHS34PF80_STATUS] |= SIM_STATUS_DRDY;
+  sim->Samples++;
+}
+
+static void sim_reset(STHS34PF80_Sim_t *sim)
+{
+  memset(sim->Reg, 0, sizeof(sim->Reg));
+  memset(sim->Embedded, 0, sizeof(sim->Embedded));
+  sim->Reg[STHS34PF80_WHO_AM_I] = STHS34PF80_SIM_WHO_AM_I;
+
+  sim->Embedded[STHS34PF80_PRESENCE_THS_L] = 200;
+  sim->Embedded[STHS34PF80_MOTION_THS_L] = 200;
+  sim->Embedded[STHS34PF80_TAMBSHOCK_THS_L] = 10;
+  sim->Embedded[STHS34PF80_HYST_MOTION] = 0x32;
+  sim->Embedded[STHS34PF80_HYST_PRESENCE] = 0x32;
+  sim->Embedded[STHS34PF80_HYST_TAMB_SHOCK] = 0x02;
+
+  sim->Detect = 0;
+  sim->OneShotUs = 0;
+}
+
+/**
+ * @brief  Power-on the simulated sensor with its reset register values
+ */
+void STHS34PF80_SimInit(STHS34PF80_Sim_t *sim)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim_reset(sim);
+  sim->BusClockHz = 400000;
+}
+
+/**
+ * @brief  A bus glitch: the next transfers are NACKed without reaching the
+ *         sensor, which with reset also browns out back to its reset values
+ * @param  sim the simulated sensor
+ * @param  nacks transfers to fail
+ * @param  reset 1 to reset the registers as well
+ */
+void STHS34PF80_SimFault(STHS34PF80_Sim_t *sim, uint32_t nacks, uint8_t reset)
+{
+  sim->FailTransfers = nacks;
+  if (reset)
+  {
+    sim_reset(sim);
+  }
+}
+
+/**
+ * @brief  Select the bus clock and per-transfer overhead used for the wire time model
+ */
+void STHS34PF80_SimSetBus(STHS34PF80_Sim_t *sim, uint32_t clock_hz, uint32_t overhead_us)
+{
+  sim->BusClockHz = clock_hz;
+  sim->BusOverheadUs = overhead_us;
+}
+
+static void sim_charge(STHS34PF80_Sim_t *sim, uint32_t bits)
+{
+  uint64_t ns;
+
+  if (sim->BusClockHz == 0)
+  {
+    return;
+  }
+
+  ns = (uint64_t)bits * 1000000000U / sim->BusClockHz + (uint64_t)sim->BusOverheadUs * 1000U;
+  sim->WireNs += ns;
+
+  ns += sim->PendingNs;
+  sim->PendingNs = ns % 1000U;
+  STHS34PF80_SimAdvance(sim, (uint32_t)(ns / 1000U));
+}
+
+void STHS34PF80_SimSetSource(STHS34PF80_Sim_t *sim, STHS34PF80_SimSource_Func source, void *arg)
+{
+  sim->Source = source;
+  sim->SourceArg = arg;
+}
+
+/**
+ * @brief  Move simulated time forward, running every conversion that falls due
+ */
+void STHS34PF80_SimAdvance(STHS34PF80_Sim_t *sim, uint32_t us)
+{
+  uint64_t target = sim->NowUs + us;
+  uint64_t next;
+  uint32_t period;
+
+  for (;;)
+  {
+    period = STHS34PF80_SimOdrPeriodUs(sim->Reg[STHS34PF80_CTRL1]);
+    next = (period != 0) ? sim->NextSampleUs : UINT64_MAX;
+    if (sim->OneShotUs != 0 && sim->OneShotUs < next)
+    {
+      next = sim->OneShotUs;
+    }
+    if (next > target)
+    {
+      break;
+    }
+
+    sim->NowUs = next;
+    if (next == sim->OneShotUs)
+    {
+      sim->OneShotUs = 0;
+    }
+    else
+    {
+      sim->NextSampleUs += period;
+    }
+    sim_convert(sim);
+  }
+
+  sim->NowUs = target;
+}
+
+/**
+ * @brief  Level of the INT pin for the current CTRL3 routing and polarity
+ */
+uint8_t STHS34PF80_SimIntPin(STHS34PF80_Sim_t *sim)
+{
+  sths34pf80_reg_t ctrl3;
+  uint8_t level = 0;
+  uint8_t mask;
+
+  ctrl3.byte = sim->Reg[STHS34PF80_CTRL3];
+  mask = (uint8_t)(ctrl3.ctrl_reg3.int_msk0 | ctrl3.ctrl_reg3.int_msk1 << 1 | ctrl3.ctrl_reg3.int_msk2 << 2);
+
+  if (ctrl3.ctrl_reg3.ien == 1)
+  {
+    level = (sim->Reg[STHS34PF80_STATUS] & SIM_STATUS_DRDY) != 0;
+  }
+  else if (ctrl3.ctrl_reg3.ien == 2)
+  {
+    level = (sim->Reg[STHS34PF80_FUNC_STATUS] & mask) != 0;
+  }
+
+  return level ^ ctrl3.ctrl_reg3.int_h_l;
+}
+
+static uint8_t sim_read_one(STHS34PF80_Sim_t *sim, uint8_t reg)
+{
+  uint8_t val;
+
+  if (reg >= sizeof(sim->Reg))
+  {
+    return 0;
+  }
+
+  if (reg == STHS34PF80_FUNC_CFG_DATA && (sim->Reg[STHS34PF80_CTRL2] & SIM_CTRL2_FUNC_CFG_ACCESS) &&
+      (sim->Reg[STHS34PF80_PAGE_RW] & STHS34PF80_FUNC_CFG_READ))
+  {
+    /* FUNC_CFG_ADDR auto-increments on every embedded access */
+    val = sim->Embedded[sim->Reg[STHS34PF80_FUNC_CFG_ADDR] & 0x3F];
+    sim->Reg[STHS34PF80_FUNC_CFG_ADDR]++;
+    return val;
+  }
+
+  val = sim->Reg[reg];
+  if (reg == STHS34PF80_FUNC_STATUS)
+  {
+    /* clear-on-read, DRDY goes with it */
+    sim->Reg[STHS34PF80_FUNC_STATUS] = 0;
+    sim->Reg[STHS34PF80_STATUS] &= (uint8_t)~SIM_STATUS_DRDY;
+  }
+  return val;
+}
+
+static void sim_write_ctrl1(STHS34PF80_Sim_t *sim, uint8_t val)
+{
+  uint8_t old_odr = sim->Reg[STHS34PF80_CTRL1] & 0x0F;
+  uint8_t new_odr = val & 0x0F;
+
+  /* the datasheet requires power-down between two running ODRs */
+  if (old_odr != 0 && new_odr != 0 && old_odr != new_odr)
+  {
+    sim->Violations++;
+  }
+  if (new_odr != 0 && new_odr != old_odr)
+  {
+    sim->NextSampleUs = sim->NowUs + STHS34PF80_SimOdrPeriodUs(new_odr);
+  }
+  sim->Reg[STHS34PF80_CTRL1] = val;
+}
+
+static void sim_write_ctrl2(STHS34PF80_Sim_t *sim, uint8_t val)
+{
+  if (val & SIM_CTRL2_BOOT)
+  {
+    sim_reset(sim);
+    return;
+  }
+  if (val & SIM_CTRL2_ONE_SHOT)
+  {
+    if (sim->Reg[STHS34PF80_CTRL1] & 0x0F)
+    {
+      sim->Violations++;     /* one-shot is only defined in power-down */
+    }
+    else
+    {
+      sim->OneShotUs = sim->NowUs + SIM_ONE_SHOT_US;
+    }
+  }
+  sim->Reg[STHS34PF80_CTRL2] = val & (uint8_t)~(SIM_CTRL2_ONE_SHOT | SIM_CTRL2_BOOT);
+}
+
+static void sim_write_embedded(STHS34PF80_Sim_t *sim, uint8_t val)
+{
+  uint8_t addr = sim->Reg[STHS34PF80_FUNC_CFG_ADDR] & 0x3F;
+
+  /* embedded registers may only be changed in power-down */
+  if (sim->Reg[STHS34PF80_CTRL1] & 0x0F)
+  {
+    sim->Violations++;
+  }
+
+  if (addr == STHS34PF80_RESET_ALGO)
+  {
+    if (val & 0x01)
+    {
+      sim->Detect = 0;
+    }
+  }
+  else
+  {
+    sim->Embedded[addr] = val;
+  }
+  sim->Reg[STHS34PF80_FUNC_CFG_ADDR]++;
+}
+
+static void sim_write_one(STHS34PF80_Sim_t *sim, uint8_t reg, uint8_t val)
+{
+  if (reg >= sizeof(sim->Reg) || reg == STHS34PF80_WHO_AM_I || reg >= STHS34PF80_STATUS)
+  {
+    sim->Violations++;     /* read-only or unmapped */
+    return;
+  }
+
+  switch (reg)
+  {
+  case STHS34PF80_FUNC_CFG_DATA:
+    if ((sim->Reg[STHS34PF80_CTRL2] & SIM_CTRL2_FUNC_CFG_ACCESS) &&
+        (sim->Reg[STHS34PF80_PAGE_RW] & STHS34PF80_FUNC_CFG_WRITE))
+    {
+      sim_write_embedded(sim, val);
+    }
+    else
+    {
+      sim->Violations++;
+    }
+    break;
+  case STHS34PF80_CTRL1:
+    sim_write_ctrl1(sim, val);
+    break;
+  case STHS34PF80_CTRL2:
+    sim_write_ctrl2(sim, val);
+    break;
+  default:
+    sim->Reg[reg] = val;
+    break;
+  }
+}
+
+int32_t STHS34PF80_SimReadReg(void *handle, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+  STHS34PF80_Sim_t *sim = (STHS34PF80_Sim_t *)handle;
+  uint16_t i;
+
+  (void)addr;
+  if (sim->FailTransfers > 0U)
+  {
+    sim->FailTransfers--;
+    sim->Nacks++;
+    sim_charge(sim, SIM_I2C_NACK_BITS);
+    return STHS34PF80_ERROR;
+  }
+  sim->ReadTransactions++;
+  sim->BytesRead += len;
+
+  /* register address auto-increments across the transfer */
+  for (i = 0; i < len; i++)
+  {
+    data[i] = sim_read_one(sim, (uint8_t)(reg + i));
+  }
+  sim_charge(sim, SIM_I2C_READ_BITS(len));
+  return STHS34PF80_OK;
+}
+
+int32_t STHS34PF80_SimWriteReg(void *handle, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len)
+{
+  STHS34PF80_Sim_t *sim = (STHS34PF80_Sim_t *)handle;
+  uint16_t i;
+
+  (void)addr;
+  if (sim->FailTransfers > 0U)
+  {
+    sim->FailTransfers--;
+    sim->Nacks++;
+    sim_charge(sim, SIM_I2C_NACK_BITS);
+    return STHS34PF80_ERROR;
+  }
+  sim->WriteTransactions++;
+  sim->BytesWritten += len;
+
+  for (i = 0; i < len; i++)
+  {
+    sim_write_one(sim, (uint8_t)(reg + i), data[i]);
+  }
+  sim_charge(sim, SIM_I2C_WRITE_BITS(len));
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Milliseconds of simulated time of the sensor bound last
+ */
+int32_t STHS34PF80_SimGetTick(void)
+{
+  return sim_bound != NULL ? (int32_t)(sim_bound->NowUs / 1000U) : 0;
+}
+
+/**
+ * @brief  Sleep in GetTick units: simulated time of the sensor bound last moves on
+ */
+void STHS34PF80_SimDelay(uint32_t ms)
+{
+  if (sim_bound != NULL)
+  {
+    STHS34PF80_SimAdvance(sim_bound, ms * 1000U);
+  }
+}
+
+static int32_t sim_bus_init(void)
+{
+  return STHS34PF80_OK;
+}
+
+/**
+ * @brief  Fill an STHS34PF80_IO_t that talks to the simulated sensor
+ */
+void STHS34PF80_SimBindIO(STHS34PF80_Sim_t *sim, STHS34PF80_IO_t *io)
+{
+  memset(io, 0, sizeof(*io));
+  io->Init     = sim_bus_init;
+  io->DeInit   = sim_bus_init;
+  io->BusType  = STHS34PF80_I2C_BURST_BUS;
+  io->Address  = 0x5A;
+  io->Handle   = sim;
+  io->ReadReg  = STHS34PF80_SimReadReg;
+  io->WriteReg = STHS34PF80_SimWriteReg;
+  io->GetTick  = STHS34PF80_SimGetTick;
+  io->Delay    = STHS34PF80_SimDelay;
+
+  sim_bound = sim;
+}
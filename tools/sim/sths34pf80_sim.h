@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#ifndef STHS34PF80_SIM_H_
+#define STHS34PF80_SIM_H_
+
+#include "sths34pf80.h"
+
+#define STHS34PF80_SIM_WHO_AM_I     0xD3
+
+/* Output values of one simulated conversion, filled by the signal source */
+typedef struct
+{
+    int16_t     TObject;
+    int16_t     TAmbient;
+    int16_t     TPresence;
+    int16_t     TMotion;
+    int16_t     TAmbShock;
+    uint8_t     FuncStatus;     /* only used when UseFlags is set */
+    uint8_t     UseFlags;       /* 0: flags derived from thresholds, 1: FuncStatus as given */
+} STHS34PF80_SimSignal_t;
+
+typedef void (*STHS34PF80_SimSource_Func)(void *arg, uint32_t now_us, STHS34PF80_SimSignal_t *signal);
+
+typedef struct
+{
+    uint8_t     Reg[0x40];          /* main register page */
+    uint8_t     Embedded[0x40];     /* embedded function page */
+    uint8_t     Detect;             /* current detection state, used for hysteresis */
+
+    uint64_t    NowUs;              /* simulated time */
+    uint64_t    NextSampleUs;       /* next conversion when free running */
+    uint64_t    OneShotUs;          /* pending one-shot completion, 0 if none */
+
+    STHS34PF80_SimSource_Func   Source;
+    void                       *SourceArg;
+
+    /* I2C wire model, every transfer advances simulated time by its duration */
+    uint32_t    BusClockHz;         /* 0 to make transfers take no time */
+    uint32_t    BusOverheadUs;      /* fixed software/controller cost per transfer */
+    uint64_t    WireNs;             /* accumulated transfer time */
+    uint32_t    PendingNs;
+
+    /* fault injection, see STHS34PF80_SimFault */
+    uint32_t    FailTransfers;      /* transfers still to NACK */
+
+    /* counters */
+    uint32_t    Samples;
+    uint32_t    ReadTransactions;
+    uint32_t    WriteTransactions;
+    uint32_t    BytesRead;
+    uint32_t    BytesWritten;
+    uint32_t    Violations;         /* accesses the datasheet does not allow */
+    uint32_t    Nacks;
+} STHS34PF80_Sim_t;
+
+void STHS34PF80_SimInit(STHS34PF80_Sim_t *sim);
+void STHS34PF80_SimSetSource(STHS34PF80_Sim_t *sim, STHS34PF80_SimSource_Func source, void *arg);
+void STHS34PF80_SimAdvance(STHS34PF80_Sim_t *sim, uint32_t us);
+void STHS34PF80_SimSetBus(STHS34PF80_Sim_t *sim, uint32_t clock_hz, uint32_t overhead_us);
+void STHS34PF80_SimFault(STHS34PF80_Sim_t *sim, uint32_t nacks, uint8_t reset);
+uint32_t STHS34PF80_SimOdrPeriodUs(uint8_t odr);
+uint8_t STHS34PF80_SimIntPin(STHS34PF80_Sim_t *sim);
+void STHS34PF80_SimBindIO(STHS34PF80_Sim_t *sim, STHS34PF80_IO_t *io);
+
+/* STHS34PF80_IO_t callbacks, handle is the STHS34PF80_Sim_t */
+int32_t STHS34PF80_SimReadReg(void *handle, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len);
+int32_t STHS34PF80_SimWriteReg(void *handle, uint16_t addr, uint16_t reg, uint8_t *data, uint16_t len);
+int32_t STHS34PF80_SimGetTick(void);
+void STHS34PF80_SimDelay(uint32_t ms);
+
+#endif /* STHS34PF80_SIM_H_ */
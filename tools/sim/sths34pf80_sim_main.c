@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <stdio.h>
+#include "sths34pf80_sim.h"
+#include "sths34pf80_conv.h"
+#include "sths34pf80_calib.h"
+#include "sths34pf80_trace.h"
+#include "sths34pf80_gov.h"
+
+/* Synthetic room scenario, optionally recorded for sths34pf80_replay:
+ *   sths34pf80_sim [trace_file]
+ */
+
+#define CALIB_FRAMES    90      /* 6 s quiet window at 15 Hz */
+#define GOV_QUIET_MS    5000    /* governor pass: step down 5 s after the room empties */
+#define FAULT_NACKS     8       /* fault pass: more than two transfers' worth of retries */
+
+static int32_t trace_write(void *arg, const uint8_t *data, uint32_t len)
+{
+    return fwrite(data, 1, len, (FILE *)arg) == len ? STHS34PF80_OK : STHS34PF80_ERROR;
+}
+
+/* Triangular noise in [-amp, amp], repeatable from run to run */
+static int16_t room_noise(int16_t amp)
+{
+    static uint32_t seed = 1;
+    int32_t a, b;
+
+    seed = seed * 1664525U + 1013904223U;
+    a = (int32_t)((seed >> 16) % (uint32_t)(amp + 1));
+    seed = seed * 1664525U + 1013904223U;
+    b = (int32_t)((seed >> 16) % (uint32_t)(amp + 1));
+    return (int16_t)(a - b);
+}
+
+/* Synthetic room: empty, a person walks in at 10 s and leaves at 20 s,
+ * counted from *arg (in us) */
+static void room_source(void *arg, uint32_t now_us, STHS34PF80_SimSignal_t *signal)
+{
+    static int16_t last;
+    uint32_t ms = (now_us - *(uint32_t *)arg) / 1000U;
+    int16_t tobj = (ms >= 10000U && ms < 20000U) ? 6000 : 0;
+
+    signal->TObject = (int16_t)(tobj + room_noise(60));
+    signal->TAmbient = 2500;
+    signal->TPresence = (int16_t)(tobj + room_noise(60));
+    signal->TMotion = (int16_t)(tobj - last + room_noise(40));
+    signal->TAmbShock = room_noise(20);
+    last = tobj;
+}
+
+int main(int argc, char **argv)
+{
+    STHS34PF80_Sim_t sim;
+    STHS34PF80_Object_t obj;
+    STHS34PF80_IO_t io;
+    STHS34PF80_Frame_t frame;
+    STHS34PF80_Values_t values;
+    STHS34PF80_TraceRecorder_t rec;
+    STHS34PF80_Calib_t calib;
+    FILE *trace = NULL;
+    uint8_t id, events;
+    uint32_t t, origin = 0, frames = 0;
+
+    STHS34PF80_SimInit(&sim);
+    STHS34PF80_SimSetSource(&sim, room_source, &origin);
+    STHS34PF80_SimBindIO(&sim, &io);
+
+    memset(&obj, 0, sizeof(obj));
+    obj.Config.LPF_Motion = 0x04;
+    obj.Config.LPF_Presence = 0x04;
+    obj.Config.LPF_Temperature = 0x02;
+    obj.Config.AVG_TMOS = 0x02;
+    obj.Config.ODR = 0x07;
+    obj.Config.THS_Presence = 5000;
+    obj.Config.THS_Motion = 2300;
+    obj.Config.THS_Temp_Shock = 2000;
+
+    if (STHS34PF80_RegisterBusIO(&obj, &io) != STHS34PF80_OK ||
+        STHS34PF80_ReadID(&obj, &id) != STHS34PF80_OK || id != STHS34PF80_SIM_WHO_AM_I)
+    {
+        printf("probe failed\n");
+        return 1;
+    }
+    if (STHS34PF80_Init(&obj) != STHS34PF80_OK)
+    {
+        printf("init failed\n");
+        return 1;
+    }
+    /* route DRDY to INT and sample on its level, as an INT-driven port would */
+    if (STHS34PF80_RouteINT(&obj, 0x01) != STHS34PF80_OK)
+    {
+        printf("int routing failed\n");
+        return 1;
+    }
+    printf("init: %u reads, %u writes, %u violations\n", (unsigned)sim.ReadTransactions,
+           (unsigned)sim.WriteTransactions, (unsigned)sim.Violations);
+
+    /* the room is empty before the scenario starts, calibrate on it */
+    STHS34PF80_CalibInit(&calib);
+    if (STHS34PF80_Calibrate(&obj, &calib, CALIB_FRAMES, 100) != STHS34PF80_OK)
+    {
+        printf("calibration failed\n");
+        return 1;
+    }
+    printf("calib: sigma %u/%u/%u, thresholds presence %u motion %u shock %u\n",
+           (unsigned)(STHS34PF80_WelfordSigma(&calib.Presence) >> 8),
+           (unsigned)(STHS34PF80_WelfordSigma(&calib.Motion) >> 8),
+           (unsigned)(STHS34PF80_WelfordSigma(&calib.AmbShock) >> 8), (unsigned)obj.Config.THS_Presence,
+           (unsigned)obj.Config.THS_Motion, (unsigned)obj.Config.THS_Temp_Shock);
+    origin = (uint32_t)sim.NowUs;
+    if (argc > 1)
+    {
+        trace = fopen(argv[1], "wb");
+        if (trace == NULL || STHS34PF80_TraceStart(&rec, &obj, 1000, trace_write, trace) != STHS34PF80_OK)
+        {
+            printf("cannot record to %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    /* check the INT pin every 10 ms for 30 s of simulated time */
+    for (t = 0; t < 30000; t += 10)
+    {
+        STHS34PF80_SimAdvance(&sim, 10000);
+        if (!STHS34PF80_SimIntPin(&sim))
+        {
+            continue;
+        }
+        if (STHS34PF80_ReadFrame(&obj, &frame) != STHS34PF80_OK ||
+            STHS34PF80_ReadEvents(&obj, STHS34PF80_EVENT_ALL, &events) != STHS34PF80_OK)
+        {
+            printf("read failed\n");
+            return 1;
+        }
+        frames++;
+        if (frames % 15 == 0)
+        {
+            STHS34PF80_ConvertFrame(&frame, STHS34PF80_UNIT_CCELSIUS, &values);
+            printf("%6u ms  tobj %6d (%5d cC)  tamb %5d cC  pres %6d  mot %6d  events 0x%02x\n", (unsigned)t,
+                   frame.TObject, (int)STHS34PF80_CompensateObject(frame.TObject, frame.TAmbient, STHS34PF80_UNIT_CCELSIUS),
+                   (int)values.TAmbient, frame.TPresence, frame.TMotion, events);
+        }
+    }
+
+    /* the trace covers the scenario only */
+    if (trace != NULL)
+    {
+        STHS34PF80_TraceStop(&rec, &obj);
+        printf("recorded %u frames (%ld bytes) to %s\n", (unsigned)rec.Frames, ftell(trace), argv[1]);
+        fclose(trace);
+    }
+
+    /* suspend for a second, resume on the kept configuration, then change ODR and back */
+    {
+        uint32_t samples, writes = sim.WriteTransactions;
+
+        if (STHS34PF80_SetPowerMode(&obj, STHS34PF80_POWER_DOWN, 100) != STHS34PF80_OK)
+        {
+            printf("suspend failed\n");
+            return 1;
+        }
+        samples = sim.Samples;
+        STHS34PF80_SimAdvance(&sim, 1000000);
+        samples = sim.Samples - samples;
+        if (STHS34PF80_SetPowerMode(&obj, STHS34PF80_POWER_NORMAL, 100) != STHS34PF80_OK ||
+            STHS34PF80_SetODR(&obj, 0x05, 100) != STHS34PF80_OK ||
+            STHS34PF80_SetODR(&obj, 0x07, 100) != STHS34PF80_OK)
+        {
+            printf("resume failed\n");
+            return 1;
+        }
+        printf("power: %u conversions while suspended, %u writes for suspend, resume and two ODR changes\n",
+               (unsigned)samples, (unsigned)(sim.WriteTransactions - writes));
+    }
+
+    /* the scenario again with the ODR governor, idle at 1 Hz until someone shows up */
+    {
+        STHS34PF80_Gov_t gov;
+        uint32_t samples = sim.Samples, reads = sim.ReadTransactions, gov_frames = 0;
+
+        origin = (uint32_t)sim.NowUs;
+        STHS34PF80_GovInit(&gov, &obj, GOV_QUIET_MS);
+        for (t = 0; t < 30000; t += 10)
+        {
+            STHS34PF80_SimAdvance(&sim, 10000);
+            if (!STHS34PF80_SimIntPin(&sim))
+            {
+                continue;
+            }
+            if (STHS34PF80_ReadFrame(&obj, &frame) != STHS34PF80_OK ||
+                STHS34PF80_GovUpdate(&gov, &obj, &frame) != STHS34PF80_OK)
+            {
+                printf("governor pass failed\n");
+                return 1;
+            }
+            gov_frames++;
+        }
+        printf("governor: %u conversions, %u frames, %u reads, %u steps up, %u down, ending at ODR %u\n",
+               (unsigned)(sim.Samples - samples), (unsigned)gov_frames, (unsigned)(sim.ReadTransactions - reads),
+               (unsigned)gov.StepsUp, (unsigned)gov.StepsDown, (unsigned)obj.Config.ODR);
+        if (STHS34PF80_SetODR(&obj, gov.ActiveODR, 100) != STHS34PF80_OK)
+        {
+            printf("governor stop failed\n");
+            return 1;
+        }
+    }
+
+    /* MCU reset with the sensor still powered: a fresh object takes it over */
+    {
+        static const char * const warm_names[] = { "verified", "ctrl3 rewritten", "reprogrammed", "rebooted" };
+        STHS34PF80_Object_t warm;
+        STHS34PF80_WarmResult_t result;
+        sths34pf80_image_t img;
+        uint32_t reads = sim.ReadTransactions, writes = sim.WriteTransactions;
+
+        memset(&warm, 0, sizeof(warm));
+        STHS34PF80_BuildImage(&obj.Config, &img);
+        if (STHS34PF80_RegisterBusIO(&warm, &io) != STHS34PF80_OK ||
+            STHS34PF80_WarmStart(&warm, &img, 0, &result) != STHS34PF80_OK)
+        {
+            printf("warm start failed\n");
+            return 1;
+        }
+        printf("warm start: %s, %u reads, %u writes\n", warm_names[result],
+               (unsigned)(sim.ReadTransactions - reads), (unsigned)(sim.WriteTransactions - writes));
+    }
+
+    /* brown-out on a noisy bus: a run of NACKs, then the sensor is back with
+     * its reset values; the loop resyncs whenever a transfer failed */
+    {
+        static const char * const resync_names[] = { "verified", "ctrl3 rewritten", "reprogrammed", "rebooted" };
+        STHS34PF80_WarmResult_t result, worst = STHS34PF80_WARM_VERIFIED;
+        sths34pf80_image_t img;
+        uint32_t failed = 0, resyncs = 0, fault_frames = 0;
+
+        /* the frame read in flight when it hits */
+        STHS34PF80_SimFault(&sim, FAULT_NACKS, 1);
+        if (STHS34PF80_ReadFrame(&obj, &frame) != STHS34PF80_OK)
+        {
+            failed++;
+        }
+        for (t = 0; t < 2000; t += 10)
+        {
+            STHS34PF80_SimAdvance(&sim, 10000);
+            if (obj.ResyncPending)
+            {
+                resyncs++;
+                if (STHS34PF80_Resync(&obj, &result) != STHS34PF80_OK)
+                {
+                    failed++;
+                }
+                else if (result > worst)
+                {
+                    worst = result;
+                }
+                continue;
+            }
+            if (!STHS34PF80_SimIntPin(&sim))
+            {
+                continue;
+            }
+            if (STHS34PF80_ReadFrame(&obj, &frame) != STHS34PF80_OK)
+            {
+                failed++;
+                continue;
+            }
+            fault_frames++;
+        }
+
+        STHS34PF80_BuildImage(&obj.Config, &img);
+        printf("fault: %u nacks, %u retried, %u given up, %u calls failed, %u resync runs (%s), %u frames after\n",
+               (unsigned)sim.Nacks, (unsigned)obj.Faults.Retried, (unsigned)obj.Faults.Failed, (unsigned)failed,
+               (unsigned)resyncs, resync_names[worst], (unsigned)fault_frames);
+        if (sim.Reg[STHS34PF80_CTRL1] != img.ctrl1 || sim.Reg[STHS34PF80_CTRL3] != obj.Ctrl3 ||
+            memcmp(&sim.Embedded[STHS34PF80_PRESENCE_THS_L], img.ths, sizeof(img.ths)) != 0 ||
+            fault_frames == 0)
+        {
+            printf("configuration not restored\n");
+            return 1;
+        }
+    }
+
+    printf("%u conversions, %u frames, %u reads (%u bytes), %u writes (%u bytes), %u violations\n",
+           (unsigned)sim.Samples, (unsigned)frames, (unsigned)sim.ReadTransactions, (unsigned)sim.BytesRead,
+           (unsigned)sim.WriteTransactions, (unsigned)sim.BytesWritten, (unsigned)sim.Violations);
+
+    return sim.Violations != 0;
+}
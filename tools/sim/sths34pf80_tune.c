@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2023-01-29     Rick       the first version
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sths34pf80_model.h"
+#include "sths34pf80_trace.h"
+
+/* Sweep LPF_P, LPF_M, THS_Presence and THS_Motion over recorded traces.
+ *   sths34pf80_tune [--top N] [--min-agree PCT] <trace>[:start-end,...] ...
+ * The intervals (ms from the start of the trace) are when somebody was
+ * really there; a trace without them is a false-positive recording. A
+ * configuration costs one per frame whose presence flag disagrees with that,
+ * one per motion flag raised outside the intervals, and the length of every
+ * interval in which motion was never flagged.
+ * The model is first checked against the TPRESENCE, TMOTION and flags the
+ * sensor recorded with the trace's own configuration; when the flags agree
+ * on fewer than PCT percent of the frames of any trace the sweep would rank
+ * a different algorithm, so nothing is swept and the exit status is 1. */
+
+#define TUNE_THS_STEPS      16      /* 100 * 2^(k/2) */
+#define TUNE_MIN_AGREE      90      /* % of frames, default of --min-agree */
+#define TUNE_MAX_TRUTH      16
+
+typedef struct
+{
+    const char                 *path;
+    STHS34PF80_TraceHeader_t    header;
+    uint32_t                    frames;
+    float                      *tobject;
+    int16_t                    *presence;
+    int16_t                    *motion;
+    uint8_t                    *flags;     /* recorded FUNC_STATUS */
+    uint8_t                    *truth;     /* somebody there */
+    double                      agree;     /* % of frames where the model flags match */
+} tune_trace_t;
+
+typedef struct
+{
+    STHS34PF80_ModelParam_t     param;
+    uint32_t                    wrong_presence;
+    uint32_t                    false_motion;
+    uint32_t                    missed_motion;  /* frames of intervals without motion */
+} tune_result_t;
+
+static int tune_parse_truth(tune_trace_t *trace, const char *spec, const uint32_t *ms)
+{
+    uint32_t start, end, i;
+    int used;
+
+    while (*spec != '\0')
+    {
+        if (sscanf(spec, "%u-%u%n", &start, &end, &used) != 2)
+        {
+            return -1;
+        }
+        for (i = 0; i < trace->frames; i++)
+        {
+            if (ms[i] >= start && ms[i] < end)
+            {
+                trace->truth[i] = 1;
+            }
+        }
+        spec += used;
+        if (*spec == ',')
+        {
+            spec++;
+        }
+    }
+    return 0;
+}
+
+static int tune_load(tune_trace_t *trace, char *arg)
+{
+    STHS34PF80_TraceReader_t reader;
+    STHS34PF80_Frame_t frame;
+    uint8_t *buf;
+    uint32_t *ms, ts, len, cap = 1024;
+    char *spec = strchr(arg, ':');
+    FILE *f;
+    long size;
+    int ret;
+
+    if (spec != NULL)
+    {
+        *spec++ = '\0';
+    }
+    trace->path = arg;
+
+    f = fopen(arg, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET) != 0)
+    {
+        return -1;
+    }
+    len = (uint32_t)size;
+    buf = malloc(len);
+    if (buf == NULL || fread(buf, 1, len, f) != len || STHS34PF80_TraceOpen(&reader, buf, len) != STHS34PF80_OK)
+    {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    trace->header = reader.Header;
+
+    trace->tobject = malloc(cap * sizeof(float));
+    trace->presence = malloc(cap * sizeof(int16_t));
+    trace->motion = malloc(cap * sizeof(int16_t));
+    trace->flags = malloc(cap);
+    ms = malloc(cap * sizeof(uint32_t));
+    while (STHS34PF80_TraceNext(&reader, &ts, &frame) == STHS34PF80_OK)
+    {
+        if (trace->frames == cap)
+        {
+            cap *= 2;
+            trace->tobject = realloc(trace->tobject, cap * sizeof(float));
+            trace->presence = realloc(trace->presence, cap * sizeof(int16_t));
+            trace->motion = realloc(trace->motion, cap * sizeof(int16_t));
+            trace->flags = realloc(trace->flags, cap);
+            ms = realloc(ms, cap * sizeof(uint32_t));
+        }
+        trace->tobject[trace->frames] = frame.TObject;
+        trace->presence[trace->frames] = frame.TPresence;
+        trace->motion[trace->frames] = frame.TMotion;
+        trace->flags[trace->frames] = frame.FuncStatus;
+        ms[trace->frames] = reader.Header.TickHz != 0 ?
+                            (uint32_t)((uint64_t)(ts - reader.Header.Start) * 1000U / reader.Header.TickHz) : 0;
+        trace->frames++;
+    }
+    free(buf);
+
+    trace->truth = calloc(trace->frames + 1, 1);
+    ret = (trace->frames == 0 || spec == NULL) ? (trace->frames == 0 ? -1 : 0) : tune_parse_truth(trace, spec, ms);
+    free(ms);
+    return ret;
+}
+
+/**
+ * @brief  Compare the model running the recorded configuration with what the sensor output
+ */
+static void tune_check(tune_trace_t *trace)
+{
+    STHS34PF80_ModelParam_t param;
+    STHS34PF80_Model_t model;
+    double err_p = 0, err_m = 0, d;
+    uint32_t agree = 0, i;
+
+    STHS34PF80_ModelDefaults(&param, &trace->header);
+    STHS34PF80_ModelInit(&model, &param, 1, trace->tobject[0]);
+    for (i = 0; i < trace->frames; i++)
+    {
+        STHS34PF80_ModelStep(&model, trace->tobject[i]);
+        d = model.Presence[0] - trace->presence[i];
+        err_p += d * d;
+        d = model.Motion[0] - trace->motion[i];
+        err_m += d * d;
+        agree += STHS34PF80_ModelFlags(&model, 0) ==
+                 (trace->flags[i] & (STHS34PF80_EVENT_PRESENCE | STHS34PF80_EVENT_MOTION));
+    }
+    trace->agree = 100.0 * agree / trace->frames;
+    printf("%s: %u frames, model vs sensor: presence rms %.0f, motion rms %.0f, flags agree %.1f%%\n",
+           trace->path, (unsigned)trace->frames, sqrt(err_p / trace->frames), sqrt(err_m / trace->frames),
+           trace->agree);
+}
+
+/**
+ * @brief  Score up to STHS34PF80_MODEL_LANES parameter sets over every trace
+ */
+static void tune_run(const tune_trace_t *traces, int count, tune_result_t *res, uint32_t lanes)
+{
+    STHS34PF80_ModelParam_t param[STHS34PF80_MODEL_LANES];
+    STHS34PF80_Model_t model;
+    uint32_t seen[STHS34PF80_MODEL_LANES];
+    uint32_t lane, i, start = 0;
+    uint8_t flags, truth;
+    int t;
+
+    for (lane = 0; lane < lanes; lane++)
+    {
+        param[lane] = res[lane].param;
+        res[lane].wrong_presence = 0;
+        res[lane].false_motion = 0;
+        res[lane].missed_motion = 0;
+    }
+
+    for (t = 0; t < count; t++)
+    {
+        STHS34PF80_ModelInit(&model, param, lanes, traces[t].tobject[0]);
+        /* truth has a zero past the last frame, so every interval ends */
+        for (i = 0; i <= traces[t].frames; i++)
+        {
+            truth = traces[t].truth[i];
+            if (truth && (i == 0 || !traces[t].truth[i - 1]))
+            {
+                start = i;
+                memset(seen, 0, sizeof(seen));
+            }
+            else if (!truth && i > 0 && traces[t].truth[i - 1])
+            {
+                for (lane = 0; lane < lanes; lane++)
+                {
+                    res[lane].missed_motion += seen[lane] ? 0 : i - start;
+                }
+            }
+            if (i == traces[t].frames)
+            {
+                break;
+            }
+
+            STHS34PF80_ModelStep(&model, traces[t].tobject[i]);
+            for (lane = 0; lane < lanes; lane++)
+            {
+                flags = STHS34PF80_ModelFlags(&model, lane);
+                res[lane].wrong_presence += ((flags & STHS34PF80_EVENT_PRESENCE) != 0) != truth;
+                res[lane].false_motion += (flags & STHS34PF80_EVENT_MOTION) != 0 && !truth;
+                seen[lane] |= flags & STHS34PF80_EVENT_MOTION;
+            }
+        }
+    }
+}
+
+static int tune_cmp(const void *a, const void *b)
+{
+    const tune_result_t *ra = a, *rb = b;
+    uint32_t ca = ra->wrong_presence + ra->false_motion + ra->missed_motion;
+    uint32_t cb = rb->wrong_presence + rb->false_motion + rb->missed_motion;
+
+    return ca < cb ? -1 : ca > cb;
+}
+
+int main(int argc, char **argv)
+{
+    tune_trace_t *traces;
+    tune_result_t *res;
+    STHS34PF80_ModelParam_t base;
+    uint32_t n = 0, total, i, frames = 0, top = 10;
+    double min_agree = TUNE_MIN_AGREE;
+    uint16_t ths[TUNE_THS_STEPS];
+    int count = 0, a;
+    uint8_t p, m, tp, tm;
+    clock_t wall;
+
+    traces = calloc((size_t)argc, sizeof(*traces));
+    for (a = 1; a < argc; a++)
+    {
+        if (!strcmp(argv[a], "--top") && a + 1 < argc)
+        {
+            top = (uint32_t)atoi(argv[++a]);
+            continue;
+        }
+        if (!strcmp(argv[a], "--min-agree") && a + 1 < argc)
+        {
+            min_agree = atof(argv[++a]);
+            continue;
+        }
+        if (tune_load(&traces[count], argv[a]) != 0)
+        {
+            printf("%s: cannot load\n", argv[a]);
+            return 1;
+        }
+        frames += traces[count].frames;
+        tune_check(&traces[count]);
+        count++;
+    }
+    if (count == 0)
+    {
+        printf("usage: %s [--top N] [--min-agree PCT] <trace>[:start-end,...] ...\n", argv[0]);
+        return 2;
+    }
+    for (a = 0; a < count; a++)
+    {
+        if (traces[a].agree < min_agree)
+        {
+            printf("%s: model disagrees with the sensor (%.1f%% < %.1f%%), not sweeping\n",
+                   traces[a].path, traces[a].agree, min_agree);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < TUNE_THS_STEPS; i++)
+    {
+        ths[i] = (uint16_t)(100.0 * pow(2.0, i / 2.0) + 0.5);
+    }
+    total = STHS34PF80_MODEL_LPF_CODES * STHS34PF80_MODEL_LPF_CODES * TUNE_THS_STEPS * TUNE_THS_STEPS;
+    res = calloc(total, sizeof(*res));
+    STHS34PF80_ModelDefaults(&base, &traces[0].header);
+    for (p = 0; p < STHS34PF80_MODEL_LPF_CODES; p++)
+    for (m = 0; m < STHS34PF80_MODEL_LPF_CODES; m++)
+    for (tp = 0; tp < TUNE_THS_STEPS; tp++)
+    for (tm = 0; tm < TUNE_THS_STEPS; tm++)
+    {
+        res[n].param = base;
+        res[n].param.LPF_P = p;
+        res[n].param.LPF_M = m;
+        res[n].param.THS_Presence = ths[tp];
+        res[n].param.THS_Motion = ths[tm];
+        n++;
+    }
+
+    wall = clock();
+    for (i = 0; i < total; i += STHS34PF80_MODEL_LANES)
+    {
+        tune_run(traces, count, &res[i], total - i < STHS34PF80_MODEL_LANES ? total - i : STHS34PF80_MODEL_LANES);
+    }
+    wall = clock() - wall;
+    qsort(res, total, sizeof(*res), tune_cmp);
+
+    printf("%u configurations x %u frames in %.2f s (%.0f M sample-configs/s, %d lanes)\n", (unsigned)total,
+           (unsigned)frames, (double)wall / CLOCKS_PER_SEC,
+           (double)total * frames / 1e6 / ((double)wall / CLOCKS_PER_SEC + 1e-9), STHS34PF80_MODEL_LANES);
+    printf("%6s %6s %7s %7s %9s %9s %9s\n", "LPF_P", "LPF_M", "THS_P", "THS_M", "presence", "motion", "missed");
+    for (i = 0; i < top && i < total; i++)
+    {
+        printf("%6u %6u %7u %7u %9u %9u %9u\n", res[i].param.LPF_P, res[i].param.LPF_M, res[i].param.THS_Presence,
+               res[i].param.THS_Motion, (unsigned)res[i].wrong_presence, (unsigned)res[i].false_motion,
+               (unsigned)res[i].missed_motion);
+    }
+
+    return 0;
+}